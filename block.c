@@ -0,0 +1,1618 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include "debug.h"
+#include "iio-lock.h"
+#include "iio-private.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(NO_THREADS)
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#endif
+
+/*
+ * Asynchronous API: the buffer owns a pool of blocks, each one the size of
+ * the buffer. Refills and pushes are queued to a worker thread, which does
+ * the transfers while the application processes the blocks that already
+ * completed. On devices using memory-mapped DMA blocks, a block is one of
+ * the kernel's blocks and no copy is made; on the other backends, each
+ * block has its own memory.
+ *
+ * iio_buffer_dequeue_block gives synchronous access to the same kernel
+ * blocks, with one handle per kernel block ID.
+ *
+ * A block is always in exactly one of these states.
+ */
+enum iio_block_state {
+	BLOCK_FREE,	/* in the pool, available for a new transfer */
+	BLOCK_QUEUED,	/* waiting for, or being processed by the worker */
+	BLOCK_DONE,	/* completed, waiting for iio_buffer_get_completion */
+	BLOCK_USER,	/* owned by the application until released */
+};
+
+struct iio_block {
+	struct iio_buffer *buf;
+	struct iio_block *next;
+	enum iio_block_state state;
+
+	/* Memory of the block, for devices not using DMA blocks */
+	void *data;
+
+	/* Current samples, and the kernel block they live in if 'mapped' */
+	void *addr;
+	size_t bytes_used;
+	unsigned int id;
+	bool mapped;
+
+	ssize_t status;
+	uint64_t timestamp;
+
+	/* Number of fan-out consumers the block is queued to or held by */
+	unsigned int refs;
+};
+
+void * iio_block_start(const struct iio_block *block)
+{
+	return block->addr;
+}
+
+void * iio_block_first(const struct iio_block *block,
+		const struct iio_channel *chn)
+{
+	if (!iio_channel_is_enabled(chn))
+		return iio_block_end(block);
+
+	return (void *) ((uintptr_t) block->addr +
+			block->buf->offsets[chn->number]);
+}
+
+void * iio_block_end(const struct iio_block *block)
+{
+	return (void *) ((uintptr_t) block->addr + block->bytes_used);
+}
+
+int iio_block_set_bytes_used(struct iio_block *block, size_t bytes_used)
+{
+	const struct iio_buffer *buf = block->buf;
+
+	if (!buf->is_output)
+		return -EPERM;
+	if (bytes_used > buf->length || bytes_used % buf->dev_sample_size)
+		return -EINVAL;
+
+	block->bytes_used = bytes_used;
+	return 0;
+}
+
+ssize_t iio_block_get_status(const struct iio_block *block)
+{
+	return block->status;
+}
+
+uint64_t iio_block_get_timestamp(const struct iio_block *block)
+{
+	return block->timestamp;
+}
+
+/* Returns true if the application holds one of the DMA blocks; must be
+ * called with dma_blocks_lock held */
+static bool dma_blocks_in_use_unlocked(const struct iio_buffer *buf)
+{
+	unsigned int i;
+
+	for (i = 0; i < buf->nb_dma_blocks; i++)
+		if (buf->dma_blocks[i] &&
+				buf->dma_blocks[i]->state == BLOCK_USER)
+			return true;
+
+	return false;
+}
+
+static bool dma_blocks_in_use(struct iio_buffer *buf)
+{
+	bool in_use;
+
+	iio_mutex_lock(buf->dma_blocks_lock);
+	in_use = dma_blocks_in_use_unlocked(buf);
+	iio_mutex_unlock(buf->dma_blocks_lock);
+
+	return in_use;
+}
+
+#if !defined(_WIN32) && !defined(NO_THREADS)
+
+struct iio_buffer_async {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	void (*callback)(struct iio_buffer *buf,
+			struct iio_block *block, void *d);
+	void *userdata;
+
+	struct iio_block *blocks;
+	unsigned int nb_blocks, nb_pending;
+	bool stop;
+
+	/* FIFOs of blocks to transfer, and of blocks that completed */
+	struct iio_block *queue_head, *queue_tail;
+	struct iio_block *done_head, *done_tail;
+
+	/* Readable as long as completed blocks are waiting. With a pipe,
+	 * fd[0] is the read end and fd[1] the write end; an eventfd is
+	 * used as both. */
+	int fd[2];
+
+	/* Scratch mask for the worker's read operations */
+	uint32_t *mask;
+};
+
+static void push_block(struct iio_block **head, struct iio_block **tail,
+		struct iio_block *block)
+{
+	block->next = NULL;
+	if (*tail)
+		(*tail)->next = block;
+	else
+		*head = block;
+	*tail = block;
+}
+
+static struct iio_block * pop_block(struct iio_block **head,
+		struct iio_block **tail)
+{
+	struct iio_block *block = *head;
+
+	if (block) {
+		*head = block->next;
+		if (!*head)
+			*tail = NULL;
+	}
+	return block;
+}
+
+static int completion_fd_open(int fd[2])
+{
+#ifdef __linux__
+	fd[0] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+	if (fd[0] < 0)
+		return -errno;
+	fd[1] = fd[0];
+#else
+	if (pipe(fd))
+		return -errno;
+	fcntl(fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fd[1], F_SETFL, O_NONBLOCK);
+	fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+#endif
+	return 0;
+}
+
+static void completion_fd_close(int fd[2])
+{
+	close(fd[0]);
+	if (fd[1] != fd[0])
+		close(fd[1]);
+}
+
+static void completion_fd_signal(int fd[2])
+{
+#ifdef __linux__
+	uint64_t event = 1;
+#else
+	uint8_t event = 1;
+#endif
+	ssize_t ret;
+
+	do {
+		ret = write(fd[1], &event, sizeof(event));
+	} while (ret == -1 && errno == EINTR);
+}
+
+static void completion_fd_ack(int fd[2])
+{
+#ifdef __linux__
+	uint64_t event;
+#else
+	uint8_t event;
+#endif
+	ssize_t ret;
+
+	do {
+		ret = read(fd[0], &event, sizeof(event));
+	} while (ret == -1 && errno == EINTR);
+}
+
+static ssize_t async_refill(struct iio_buffer *buf, struct iio_block *block,
+		uint32_t *mask)
+{
+	const struct iio_device *dev = buf->dev;
+	ssize_t ret;
+
+	if (buf->dev_is_high_speed) {
+		ret = dev->ctx->ops->dequeue_block(dev,
+				&block->id, &block->addr);
+		block->mapped = ret >= 0;
+	} else {
+		block->addr = block->data;
+		ret = iio_device_read_raw(dev, block->data, buf->length,
+				mask, dev->words);
+	}
+
+	block->bytes_used = ret < 0 ? 0 : (size_t) ret;
+	return ret;
+}
+
+static ssize_t async_push(struct iio_buffer *buf, struct iio_block *block)
+{
+	const struct iio_device *dev = buf->dev;
+	ssize_t ret;
+
+	if (buf->dev_is_high_speed) {
+		/* Hand the block over to the kernel, and take back the next
+		 * one it is done with, so that the completed block can be
+		 * filled again right away */
+		ret = (ssize_t) dev->ctx->ops->enqueue_block(dev,
+				block->id, block->bytes_used);
+		if (ret < 0)
+			return ret;
+
+		block->mapped = false;
+		ret = dev->ctx->ops->dequeue_block(dev,
+				&block->id, &block->addr);
+		if (ret < 0)
+			return ret;
+
+		block->mapped = true;
+	} else {
+		uintptr_t ptr = (uintptr_t) block->data;
+		size_t len;
+
+		for (len = block->bytes_used; len; ) {
+			ret = iio_device_write_raw(dev, (void *) ptr, len);
+			if (ret < 0)
+				return ret;
+
+			len -= ret;
+			ptr += ret;
+		}
+	}
+
+	return (ssize_t) block->bytes_used;
+}
+
+static void * async_worker(void *d)
+{
+	struct iio_buffer *buf = d;
+	struct iio_buffer_async *async = buf->async;
+	struct iio_block *block;
+	uint64_t start_ns;
+
+	pthread_mutex_lock(&async->lock);
+
+	for (;;) {
+		while (!async->stop && !async->queue_head)
+			pthread_cond_wait(&async->cond, &async->lock);
+		if (async->stop)
+			break;
+
+		block = pop_block(&async->queue_head, &async->queue_tail);
+		pthread_mutex_unlock(&async->lock);
+
+		start_ns = iio_time_ns();
+
+		if (buf->is_output)
+			block->status = async_push(buf, block);
+		else
+			block->status = async_refill(buf, block, async->mask);
+
+		block->timestamp = iio_buffer_stats_update(buf,
+				buf->is_output, start_ns, block->status);
+
+		pthread_mutex_lock(&async->lock);
+		async->nb_pending--;
+		pthread_cond_broadcast(&async->cond);
+
+		if (async->callback) {
+			block->state = BLOCK_USER;
+			pthread_mutex_unlock(&async->lock);
+			async->callback(buf, block, async->userdata);
+			pthread_mutex_lock(&async->lock);
+		} else {
+			block->state = BLOCK_DONE;
+			push_block(&async->done_head, &async->done_tail, block);
+			completion_fd_signal(async->fd);
+		}
+	}
+
+	pthread_mutex_unlock(&async->lock);
+	return NULL;
+}
+
+static void free_blocks(struct iio_block *blocks, unsigned int nb)
+{
+	unsigned int i;
+
+	for (i = 0; i < nb; i++)
+		free(blocks[i].data);
+	free(blocks);
+}
+
+int iio_buffer_start_async(struct iio_buffer *buf, unsigned int nb_blocks,
+		void (*callback)(struct iio_buffer *buf,
+			struct iio_block *block, void *d), void *d)
+{
+	const struct iio_device *dev = buf->dev;
+	struct iio_buffer_async *async;
+	unsigned int i;
+	int ret;
+
+	if (buf->async || buf->stream || buf->fanout || buf->ring)
+		return -EBUSY;
+	if (!nb_blocks)
+		return -EINVAL;
+
+	if (dma_blocks_in_use(buf))
+		return -EBUSY;
+	if (buf->dev_is_high_speed && (!dev->ctx->ops->dequeue_block ||
+				!dev->ctx->ops->enqueue_block))
+		return -ENOSYS;
+
+	async = zalloc(sizeof(*async));
+	if (!async)
+		return -ENOMEM;
+
+	async->callback = callback;
+	async->userdata = d;
+	async->nb_blocks = nb_blocks;
+
+	async->mask = calloc(dev->words, sizeof(*async->mask));
+	if (!async->mask) {
+		ret = -ENOMEM;
+		goto err_free_async;
+	}
+
+	async->blocks = calloc(nb_blocks, sizeof(*async->blocks));
+	if (!async->blocks) {
+		ret = -ENOMEM;
+		goto err_free_mask;
+	}
+
+	for (i = 0; i < nb_blocks; i++) {
+		struct iio_block *block = &async->blocks[i];
+
+		block->buf = buf;
+		block->bytes_used = buf->length;
+
+		if (!buf->dev_is_high_speed) {
+			block->data = malloc(buf->length);
+			if (!block->data) {
+				ret = -ENOMEM;
+				goto err_free_blocks;
+			}
+			block->addr = block->data;
+		}
+	}
+
+	ret = completion_fd_open(async->fd);
+	if (ret < 0)
+		goto err_free_blocks;
+
+	pthread_mutex_init(&async->lock, NULL);
+	pthread_cond_init(&async->cond, NULL);
+
+	buf->async = async;
+
+	ret = -pthread_create(&async->thread, NULL, async_worker, buf);
+	if (ret < 0)
+		goto err_destroy_lock;
+
+	return 0;
+
+err_destroy_lock:
+	buf->async = NULL;
+	pthread_cond_destroy(&async->cond);
+	pthread_mutex_destroy(&async->lock);
+	completion_fd_close(async->fd);
+err_free_blocks:
+	free_blocks(async->blocks, nb_blocks);
+err_free_mask:
+	free(async->mask);
+err_free_async:
+	free(async);
+	return ret;
+}
+
+static void free_async(struct iio_buffer *buf)
+{
+	struct iio_buffer_async *async = buf->async;
+
+	if (!async)
+		return;
+
+	pthread_mutex_lock(&async->lock);
+	async->stop = true;
+	pthread_cond_broadcast(&async->cond);
+	pthread_mutex_unlock(&async->lock);
+
+	/* The worker may be blocked in a transfer, which only returns with
+	 * the device's timeout, or never if there is none */
+	iio_buffer_cancel(buf);
+	pthread_join(async->thread, NULL);
+
+	pthread_cond_destroy(&async->cond);
+	pthread_mutex_destroy(&async->lock);
+	completion_fd_close(async->fd);
+	free_blocks(async->blocks, async->nb_blocks);
+	free(async->mask);
+	free(async);
+	buf->async = NULL;
+}
+
+static struct iio_block * find_free_block(struct iio_buffer_async *async)
+{
+	unsigned int i;
+
+	for (i = 0; i < async->nb_blocks; i++)
+		if (async->blocks[i].state == BLOCK_FREE)
+			return &async->blocks[i];
+	return NULL;
+}
+
+static void queue_block(struct iio_buffer_async *async,
+		struct iio_block *block)
+{
+	block->state = BLOCK_QUEUED;
+	block->status = 0;
+	async->nb_pending++;
+	push_block(&async->queue_head, &async->queue_tail, block);
+	pthread_cond_broadcast(&async->cond);
+}
+
+int iio_buffer_submit_refill(struct iio_buffer *buf)
+{
+	struct iio_buffer_async *async = buf->async;
+	struct iio_block *block;
+	int ret = 0;
+
+	if (!async)
+		return -EBADF;
+	if (buf->is_output)
+		return -EPERM;
+
+	pthread_mutex_lock(&async->lock);
+
+	block = find_free_block(async);
+	if (block)
+		queue_block(async, block);
+	else
+		ret = -EBUSY;
+
+	pthread_mutex_unlock(&async->lock);
+	return ret;
+}
+
+struct iio_block * iio_buffer_get_block(struct iio_buffer *buf)
+{
+	struct iio_buffer_async *async = buf->async;
+	const struct iio_device *dev = buf->dev;
+	struct iio_block *block;
+	ssize_t ret;
+
+	if (!async || !buf->is_output) {
+		errno = async ? EPERM : EBADF;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&async->lock);
+	block = find_free_block(async);
+	if (block)
+		block->state = BLOCK_USER;
+	pthread_mutex_unlock(&async->lock);
+
+	if (!block) {
+		errno = EBUSY;
+		return NULL;
+	}
+
+	/* An output DMA block that was never pushed is still in the
+	 * kernel's queue: wait for it to come back */
+	if (buf->dev_is_high_speed && !block->mapped) {
+		ret = dev->ctx->ops->dequeue_block(dev,
+				&block->id, &block->addr);
+		if (ret < 0) {
+			pthread_mutex_lock(&async->lock);
+			block->state = BLOCK_FREE;
+			pthread_mutex_unlock(&async->lock);
+			errno = (int) -ret;
+			return NULL;
+		}
+
+		block->mapped = true;
+	}
+
+	block->bytes_used = buf->length;
+	block->status = 0;
+	return block;
+}
+
+int iio_buffer_submit_push(struct iio_buffer *buf,
+		struct iio_block *block, size_t samples_count)
+{
+	struct iio_buffer_async *async = buf->async;
+	size_t len = samples_count * buf->dev_sample_size;
+
+	if (!async)
+		return -EBADF;
+	if (!buf->is_output)
+		return -EPERM;
+	if (block->buf != buf || block->state != BLOCK_USER ||
+			!len || len > buf->length)
+		return -EINVAL;
+
+	block->bytes_used = len;
+
+	pthread_mutex_lock(&async->lock);
+	queue_block(async, block);
+	pthread_mutex_unlock(&async->lock);
+	return 0;
+}
+
+struct iio_block * iio_buffer_get_completion(struct iio_buffer *buf,
+		bool wait)
+{
+	struct iio_buffer_async *async = buf->async;
+	struct iio_block *block;
+
+	if (!async) {
+		errno = EBADF;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&async->lock);
+
+	while (wait && !async->done_head && async->nb_pending)
+		pthread_cond_wait(&async->cond, &async->lock);
+
+	block = pop_block(&async->done_head, &async->done_tail);
+	if (block) {
+		block->state = BLOCK_USER;
+		completion_fd_ack(async->fd);
+	}
+
+	pthread_mutex_unlock(&async->lock);
+
+	if (!block)
+		errno = EAGAIN;
+	return block;
+}
+
+int iio_buffer_get_completion_fd(const struct iio_buffer *buf)
+{
+	return buf->async ? buf->async->fd[0] : -EBADF;
+}
+
+int iio_buffer_release_block(struct iio_buffer *buf, struct iio_block *block)
+{
+	struct iio_buffer_async *async = buf->async;
+	const struct iio_device *dev = buf->dev;
+	int ret;
+
+	if (!async)
+		return -EBADF;
+	if (block->buf != buf || block->state != BLOCK_USER)
+		return -EINVAL;
+
+	/* Input DMA blocks go back to the kernel to be filled again; output
+	 * ones are kept, to be handed out by iio_buffer_get_block */
+	if (block->mapped && !buf->is_output) {
+		ret = dev->ctx->ops->enqueue_block(dev,
+				block->id, buf->length);
+		if (ret < 0)
+			return ret;
+
+		block->mapped = false;
+	}
+
+	pthread_mutex_lock(&async->lock);
+	block->state = BLOCK_FREE;
+	pthread_mutex_unlock(&async->lock);
+	return 0;
+}
+
+/*
+ * Streaming mode: a thread refills the blocks of an input buffer ahead of
+ * iio_buffer_refill. Filled blocks go from the thread to iio_buffer_refill
+ * through the 'ready' ring, and iio_buffer_refill gives the block it held
+ * before back through the 'free' ring.
+ *
+ * Both rings are lock-free. 'ready' has one producer but two consumers, as
+ * the thread takes the oldest block back when dropping it: entries are
+ * claimed with a compare-and-swap on 'head'. The lock and condition are
+ * only used to sleep while a ring is empty.
+ */
+struct block_ring {
+	struct iio_block **slots;
+	unsigned int size;
+	unsigned long head, tail;
+};
+
+struct iio_buffer_stream {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int waiters;
+
+	struct iio_block *blocks;
+	uint32_t *masks;
+	unsigned int nb_blocks;
+	struct block_ring ready, free;
+
+	/* Block whose samples are exposed by the buffer, and the buffer's
+	 * own memory, restored when streaming stops */
+	struct iio_block *held;
+	void *buffer;
+
+	enum iio_stream_overrun overrun;
+	uint64_t dropped;
+	ssize_t error;
+	bool blocking, stop;
+};
+
+static bool ring_push(struct block_ring *ring, struct iio_block *block)
+{
+	unsigned long tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->size)
+		return false;
+
+	__atomic_store_n(&ring->slots[tail % ring->size],
+			block, __ATOMIC_RELAXED);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static struct iio_block * ring_pop(struct block_ring *ring)
+{
+	unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	struct iio_block *block;
+
+	/* The producer never writes the slot at 'head' before 'head' has
+	 * moved, in which case the compare-and-swap fails and the slot is
+	 * read again */
+	do {
+		if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE))
+			return NULL;
+
+		block = __atomic_load_n(&ring->slots[head % ring->size],
+				__ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&ring->head, &head, head + 1,
+				false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	return block;
+}
+
+static void stream_wake(struct iio_buffer_stream *stream)
+{
+	/* Pairs with the increment of 'waiters' in stream_wait(): either
+	 * the waiter sees the block just pushed, or it is seen here */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&stream->waiters, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&stream->lock);
+		pthread_cond_broadcast(&stream->cond);
+		pthread_mutex_unlock(&stream->lock);
+	}
+}
+
+static struct iio_block * stream_wait(struct iio_buffer_stream *stream,
+		struct block_ring *ring)
+{
+	struct iio_block *block;
+
+	pthread_mutex_lock(&stream->lock);
+	__atomic_add_fetch(&stream->waiters, 1, __ATOMIC_SEQ_CST);
+
+	while (!(block = ring_pop(ring)) &&
+			!__atomic_load_n(&stream->stop, __ATOMIC_ACQUIRE))
+		pthread_cond_wait(&stream->cond, &stream->lock);
+
+	__atomic_sub_fetch(&stream->waiters, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&stream->lock);
+	return block;
+}
+
+static uint32_t * stream_mask(const struct iio_buffer *buf,
+		const struct iio_block *block)
+{
+	struct iio_buffer_stream *stream = buf->stream;
+
+	return &stream->masks[(block - stream->blocks) * buf->dev->words];
+}
+
+static void * stream_worker(void *d)
+{
+	struct iio_buffer *buf = d;
+	struct iio_buffer_stream *stream = buf->stream;
+	const struct iio_device *dev = buf->dev;
+	struct iio_block *block;
+	ssize_t ret;
+
+	while (!__atomic_load_n(&stream->stop, __ATOMIC_ACQUIRE)) {
+		block = ring_pop(&stream->free);
+
+		if (!block && stream->overrun == IIO_STREAM_OVERRUN_DROP_OLDEST) {
+			block = ring_pop(&stream->ready);
+			if (block)
+				__atomic_add_fetch(&stream->dropped,
+						1, __ATOMIC_RELAXED);
+		}
+
+		if (!block) {
+			block = stream_wait(stream, &stream->free);
+			if (!block)
+				break;
+		}
+
+		ret = iio_device_read_raw(dev, block->data, buf->length,
+				stream_mask(buf, block), dev->words);
+		block->timestamp = iio_time_ns();
+		block->status = ret;
+		block->bytes_used = ret < 0 ? 0 : (size_t) ret;
+
+		ring_push(&stream->ready, block);
+
+		/* Timeouts are reported, but do not stop the stream */
+		if (ret < 0 && ret != -ETIMEDOUT && ret != -EAGAIN) {
+			stream->error = ret;
+			__atomic_store_n(&stream->stop, true, __ATOMIC_RELEASE);
+		}
+
+		stream_wake(stream);
+	}
+
+	return NULL;
+}
+
+int iio_buffer_start_streaming(struct iio_buffer *buf,
+		unsigned int nb_blocks, enum iio_stream_overrun overrun)
+{
+	const struct iio_device *dev = buf->dev;
+	struct iio_buffer_stream *stream;
+	unsigned int i;
+	int ret;
+
+	if (buf->async || buf->stream || buf->fanout || buf->ring)
+		return -EBUSY;
+	if (buf->is_output)
+		return -EPERM;
+	if (buf->dev_is_high_speed)
+		return -ENOSYS;
+	if (nb_blocks < 2)
+		return -EINVAL;
+
+	stream = zalloc(sizeof(*stream));
+	if (!stream)
+		return -ENOMEM;
+
+	stream->nb_blocks = nb_blocks;
+	stream->overrun = overrun;
+	stream->blocking = true;
+	stream->buffer = buf->buffer;
+
+	stream->blocks = calloc(nb_blocks, sizeof(*stream->blocks));
+	stream->masks = calloc(nb_blocks * dev->words, sizeof(*stream->masks));
+	stream->ready.slots = calloc(nb_blocks, sizeof(*stream->ready.slots));
+	stream->free.slots = calloc(nb_blocks, sizeof(*stream->free.slots));
+	if (!stream->blocks || !stream->masks ||
+			!stream->ready.slots || !stream->free.slots) {
+		ret = -ENOMEM;
+		goto err_free_stream;
+	}
+
+	stream->ready.size = nb_blocks;
+	stream->free.size = nb_blocks;
+
+	for (i = 0; i < nb_blocks; i++) {
+		struct iio_block *block = &stream->blocks[i];
+
+		block->buf = buf;
+		block->data = malloc(buf->length);
+		if (!block->data) {
+			ret = -ENOMEM;
+			goto err_free_stream;
+		}
+
+		block->addr = block->data;
+		ring_push(&stream->free, block);
+	}
+
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->cond, NULL);
+
+	buf->stream = stream;
+
+	ret = -pthread_create(&stream->thread, NULL, stream_worker, buf);
+	if (ret < 0)
+		goto err_destroy_lock;
+
+	return 0;
+
+err_destroy_lock:
+	buf->stream = NULL;
+	pthread_cond_destroy(&stream->cond);
+	pthread_mutex_destroy(&stream->lock);
+err_free_stream:
+	if (stream->blocks)
+		free_blocks(stream->blocks, nb_blocks);
+	free(stream->masks);
+	free(stream->ready.slots);
+	free(stream->free.slots);
+	free(stream);
+	return ret;
+}
+
+static void free_stream(struct iio_buffer *buf)
+{
+	struct iio_buffer_stream *stream = buf->stream;
+
+	if (!stream)
+		return;
+
+	__atomic_store_n(&stream->stop, true, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&stream->lock);
+	pthread_cond_broadcast(&stream->cond);
+	pthread_mutex_unlock(&stream->lock);
+
+	/* Streaming forces the blocking mode: interrupt the read in
+	 * progress */
+	iio_buffer_cancel(buf);
+	pthread_join(stream->thread, NULL);
+
+	buf->buffer = stream->buffer;
+
+	pthread_cond_destroy(&stream->cond);
+	pthread_mutex_destroy(&stream->lock);
+	free_blocks(stream->blocks, stream->nb_blocks);
+	free(stream->masks);
+	free(stream->ready.slots);
+	free(stream->free.slots);
+	free(stream);
+	buf->stream = NULL;
+}
+
+ssize_t iio_buffer_stream_refill(struct iio_buffer *buf)
+{
+	struct iio_buffer_stream *stream = buf->stream;
+	struct iio_block *block;
+	ssize_t ret;
+
+	if (stream->held) {
+		ring_push(&stream->free, stream->held);
+		stream->held = NULL;
+		stream_wake(stream);
+	}
+
+	block = ring_pop(&stream->ready);
+	if (!block) {
+		if (!stream->blocking)
+			return -EAGAIN;
+
+		block = stream_wait(stream, &stream->ready);
+		if (!block)
+			return stream->error ? stream->error : -EBADF;
+	}
+
+	ret = block->status;
+	if (ret < 0) {
+		ring_push(&stream->free, block);
+		stream_wake(stream);
+		return ret;
+	}
+
+	stream->held = block;
+	buf->buffer = block->data;
+	buf->timestamp = block->timestamp;
+	memcpy(buf->mask, stream_mask(buf, block),
+			buf->dev->words * sizeof(*buf->mask));
+	return ret;
+}
+
+void iio_buffer_stream_set_blocking_mode(struct iio_buffer *buf,
+		bool blocking)
+{
+	buf->stream->blocking = blocking;
+}
+
+uint64_t iio_buffer_get_dropped_blocks(const struct iio_buffer *buf)
+{
+	if (!buf->stream)
+		return 0;
+
+	return __atomic_load_n(&buf->stream->dropped, __ATOMIC_RELAXED);
+}
+
+/*
+ * Fan-out: a thread refills the blocks of an input buffer, and publishes
+ * each one to all the registered consumers. A block counts the consumers
+ * it was queued to, and is recycled (given back to the kernel, for DMA
+ * blocks) once the last of them released it. Each consumer has a queue of
+ * at most 'max_queued' blocks; when it is full, the thread either waits
+ * for the consumer or skips it, according to the consumer's policy.
+ */
+struct iio_buffer_consumer {
+	struct iio_buffer_fanout *fanout;
+	struct iio_buffer_consumer *next;
+	enum iio_consumer_policy policy;
+
+	/* Ring of the blocks published to the consumer, not yet taken */
+	const struct iio_block **queue;
+	unsigned int max_queued, head, nb_queued;
+
+	uint64_t dropped;
+};
+
+struct iio_buffer_fanout {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	struct iio_block *blocks;
+	unsigned int nb_blocks;
+	struct iio_block *free_head, *free_tail;
+
+	struct iio_buffer_consumer *consumers;
+	ssize_t error;
+	bool stop;
+
+	/* Scratch mask for the thread's read operations */
+	uint32_t *mask;
+};
+
+/* Called with the lock held */
+static void fanout_recycle(struct iio_buffer *buf, struct iio_block *block)
+{
+	struct iio_buffer_fanout *fanout = buf->fanout;
+	const struct iio_device *dev = buf->dev;
+
+	if (block->mapped) {
+		dev->ctx->ops->enqueue_block(dev, block->id, buf->length);
+		block->mapped = false;
+	}
+
+	block->state = BLOCK_FREE;
+	push_block(&fanout->free_head, &fanout->free_tail, block);
+	pthread_cond_broadcast(&fanout->cond);
+}
+
+/* Called with the lock held */
+static bool fanout_must_wait(const struct iio_buffer_fanout *fanout)
+{
+	const struct iio_buffer_consumer *consumer;
+
+	for (consumer = fanout->consumers; consumer; consumer = consumer->next)
+		if (consumer->policy == IIO_CONSUMER_BLOCK &&
+				consumer->nb_queued == consumer->max_queued)
+			return true;
+	return false;
+}
+
+/* Called with the lock held */
+static void fanout_publish(struct iio_buffer *buf, struct iio_block *block)
+{
+	struct iio_buffer_fanout *fanout = buf->fanout;
+	struct iio_buffer_consumer *consumer;
+
+	block->refs = 0;
+	block->state = BLOCK_USER;
+
+	for (consumer = fanout->consumers; consumer; consumer = consumer->next) {
+		unsigned int tail;
+
+		if (consumer->nb_queued == consumer->max_queued) {
+			consumer->dropped++;
+			continue;
+		}
+
+		tail = (consumer->head + consumer->nb_queued) %
+			consumer->max_queued;
+		consumer->queue[tail] = block;
+		consumer->nb_queued++;
+		block->refs++;
+	}
+
+	if (!block->refs)
+		fanout_recycle(buf, block);
+
+	pthread_cond_broadcast(&fanout->cond);
+}
+
+static void * fanout_worker(void *d)
+{
+	struct iio_buffer *buf = d;
+	struct iio_buffer_fanout *fanout = buf->fanout;
+	struct iio_block *block;
+	uint64_t start_ns;
+	ssize_t ret;
+
+	pthread_mutex_lock(&fanout->lock);
+
+	for (;;) {
+		/* Capture only while someone is listening */
+		while (!fanout->stop && (!fanout->consumers ||
+					!fanout->free_head))
+			pthread_cond_wait(&fanout->cond, &fanout->lock);
+		if (fanout->stop)
+			break;
+
+		block = pop_block(&fanout->free_head, &fanout->free_tail);
+		block->state = BLOCK_QUEUED;
+		pthread_mutex_unlock(&fanout->lock);
+
+		start_ns = iio_time_ns();
+		ret = async_refill(buf, block, fanout->mask);
+		block->status = ret;
+		block->timestamp = iio_buffer_stats_update(buf,
+				false, start_ns, ret);
+
+		pthread_mutex_lock(&fanout->lock);
+
+		if (ret < 0) {
+			fanout_recycle(buf, block);
+
+			/* Timeouts are reported, but do not stop the fan-out */
+			if (ret == -ETIMEDOUT || ret == -EAGAIN)
+				continue;
+
+			fanout->error = ret;
+			fanout->stop = true;
+			pthread_cond_broadcast(&fanout->cond);
+			break;
+		}
+
+		while (!fanout->stop && fanout_must_wait(fanout))
+			pthread_cond_wait(&fanout->cond, &fanout->lock);
+
+		if (fanout->stop) {
+			fanout_recycle(buf, block);
+			break;
+		}
+
+		fanout_publish(buf, block);
+	}
+
+	pthread_mutex_unlock(&fanout->lock);
+	return NULL;
+}
+
+int iio_buffer_start_fanout(struct iio_buffer *buf, unsigned int nb_blocks)
+{
+	const struct iio_device *dev = buf->dev;
+	struct iio_buffer_fanout *fanout;
+	unsigned int i;
+	int ret;
+
+	if (buf->async || buf->stream || buf->fanout || buf->ring)
+		return -EBUSY;
+	if (buf->is_output)
+		return -EPERM;
+	if (!nb_blocks)
+		return -EINVAL;
+
+	ret = iio_buffer_release_dma_blocks(buf);
+	if (ret < 0)
+		return ret;
+	if (buf->dev_is_high_speed && (!dev->ctx->ops->dequeue_block ||
+				!dev->ctx->ops->enqueue_block))
+		return -ENOSYS;
+
+	fanout = zalloc(sizeof(*fanout));
+	if (!fanout)
+		return -ENOMEM;
+
+	fanout->nb_blocks = nb_blocks;
+
+	fanout->mask = calloc(dev->words, sizeof(*fanout->mask));
+	fanout->blocks = calloc(nb_blocks, sizeof(*fanout->blocks));
+	if (!fanout->mask || !fanout->blocks) {
+		ret = -ENOMEM;
+		goto err_free_fanout;
+	}
+
+	for (i = 0; i < nb_blocks; i++) {
+		struct iio_block *block = &fanout->blocks[i];
+
+		block->buf = buf;
+
+		if (!buf->dev_is_high_speed) {
+			block->data = malloc(buf->length);
+			if (!block->data) {
+				ret = -ENOMEM;
+				goto err_free_fanout;
+			}
+		}
+
+		push_block(&fanout->free_head, &fanout->free_tail, block);
+	}
+
+	pthread_mutex_init(&fanout->lock, NULL);
+	pthread_cond_init(&fanout->cond, NULL);
+
+	buf->fanout = fanout;
+
+	ret = -pthread_create(&fanout->thread, NULL, fanout_worker, buf);
+	if (ret < 0)
+		goto err_destroy_lock;
+
+	return 0;
+
+err_destroy_lock:
+	buf->fanout = NULL;
+	pthread_cond_destroy(&fanout->cond);
+	pthread_mutex_destroy(&fanout->lock);
+err_free_fanout:
+	if (fanout->blocks)
+		free_blocks(fanout->blocks, nb_blocks);
+	free(fanout->mask);
+	free(fanout);
+	return ret;
+}
+
+static void free_consumer(struct iio_buffer_consumer *consumer)
+{
+	free(consumer->queue);
+	free(consumer);
+}
+
+static void free_fanout(struct iio_buffer *buf)
+{
+	struct iio_buffer_fanout *fanout = buf->fanout;
+	struct iio_buffer_consumer *consumer;
+
+	if (!fanout)
+		return;
+
+	pthread_mutex_lock(&fanout->lock);
+	fanout->stop = true;
+	pthread_cond_broadcast(&fanout->cond);
+	pthread_mutex_unlock(&fanout->lock);
+
+	/* As for the other worker threads, don't wait for the read in
+	 * progress */
+	iio_buffer_cancel(buf);
+	pthread_join(fanout->thread, NULL);
+
+	while (fanout->consumers) {
+		consumer = fanout->consumers;
+		fanout->consumers = consumer->next;
+		free_consumer(consumer);
+	}
+
+	pthread_cond_destroy(&fanout->cond);
+	pthread_mutex_destroy(&fanout->lock);
+	free_blocks(fanout->blocks, fanout->nb_blocks);
+	free(fanout->mask);
+	free(fanout);
+	buf->fanout = NULL;
+}
+
+struct iio_buffer_consumer * iio_buffer_add_consumer(struct iio_buffer *buf,
+		unsigned int max_queued, enum iio_consumer_policy policy)
+{
+	struct iio_buffer_fanout *fanout = buf->fanout;
+	struct iio_buffer_consumer *consumer;
+
+	if (!fanout) {
+		errno = EBADF;
+		return NULL;
+	}
+	if (!max_queued) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	consumer = zalloc(sizeof(*consumer));
+	if (!consumer) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	consumer->queue = calloc(max_queued, sizeof(*consumer->queue));
+	if (!consumer->queue) {
+		free(consumer);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	consumer->fanout = fanout;
+	consumer->policy = policy;
+	consumer->max_queued = max_queued;
+
+	pthread_mutex_lock(&fanout->lock);
+	consumer->next = fanout->consumers;
+	fanout->consumers = consumer;
+	pthread_cond_broadcast(&fanout->cond);
+	pthread_mutex_unlock(&fanout->lock);
+
+	return consumer;
+}
+
+/* Called with the lock held */
+static void consumer_unref(struct iio_buffer_consumer *consumer,
+		const struct iio_block *block)
+{
+	struct iio_block *blk = (struct iio_block *) block;
+
+	if (!--blk->refs)
+		fanout_recycle(blk->buf, blk);
+}
+
+void iio_buffer_remove_consumer(struct iio_buffer_consumer *consumer)
+{
+	struct iio_buffer_fanout *fanout = consumer->fanout;
+	struct iio_buffer_consumer **ptr;
+
+	pthread_mutex_lock(&fanout->lock);
+
+	for (ptr = &fanout->consumers; *ptr; ptr = &(*ptr)->next) {
+		if (*ptr == consumer) {
+			*ptr = consumer->next;
+			break;
+		}
+	}
+
+	/* Release the blocks the consumer never took */
+	for (; consumer->nb_queued; consumer->nb_queued--) {
+		consumer_unref(consumer, consumer->queue[consumer->head]);
+		consumer->head = (consumer->head + 1) % consumer->max_queued;
+	}
+
+	pthread_cond_broadcast(&fanout->cond);
+	pthread_mutex_unlock(&fanout->lock);
+
+	free_consumer(consumer);
+}
+
+const struct iio_block * iio_buffer_consumer_get_block(
+		struct iio_buffer_consumer *consumer, bool wait)
+{
+	struct iio_buffer_fanout *fanout = consumer->fanout;
+	const struct iio_block *block = NULL;
+
+	pthread_mutex_lock(&fanout->lock);
+
+	while (wait && !consumer->nb_queued && !fanout->stop)
+		pthread_cond_wait(&fanout->cond, &fanout->lock);
+
+	if (consumer->nb_queued) {
+		block = consumer->queue[consumer->head];
+		consumer->head = (consumer->head + 1) % consumer->max_queued;
+		consumer->nb_queued--;
+
+		/* Room was made for a blocking consumer */
+		pthread_cond_broadcast(&fanout->cond);
+	} else if (fanout->error) {
+		errno = (int) -fanout->error;
+	} else {
+		errno = fanout->stop ? EBADF : EAGAIN;
+	}
+
+	pthread_mutex_unlock(&fanout->lock);
+	return block;
+}
+
+void iio_buffer_consumer_release_block(struct iio_buffer_consumer *consumer,
+		const struct iio_block *block)
+{
+	struct iio_buffer_fanout *fanout = consumer->fanout;
+
+	pthread_mutex_lock(&fanout->lock);
+	consumer_unref(consumer, block);
+	pthread_mutex_unlock(&fanout->lock);
+}
+
+uint64_t iio_buffer_consumer_get_dropped_blocks(
+		const struct iio_buffer_consumer *consumer)
+{
+	struct iio_buffer_fanout *fanout = consumer->fanout;
+	uint64_t dropped;
+
+	pthread_mutex_lock(&fanout->lock);
+	dropped = consumer->dropped;
+	pthread_mutex_unlock(&fanout->lock);
+
+	return dropped;
+}
+
+#else /* _WIN32 || NO_THREADS */
+
+int iio_buffer_start_async(struct iio_buffer *buf, unsigned int nb_blocks,
+		void (*callback)(struct iio_buffer *buf,
+			struct iio_block *block, void *d), void *d)
+{
+	return -ENOSYS;
+}
+
+static void free_async(struct iio_buffer *buf)
+{
+}
+
+int iio_buffer_submit_refill(struct iio_buffer *buf)
+{
+	return -EBADF;
+}
+
+struct iio_block * iio_buffer_get_block(struct iio_buffer *buf)
+{
+	errno = EBADF;
+	return NULL;
+}
+
+int iio_buffer_submit_push(struct iio_buffer *buf,
+		struct iio_block *block, size_t samples_count)
+{
+	return -EBADF;
+}
+
+struct iio_block * iio_buffer_get_completion(struct iio_buffer *buf,
+		bool wait)
+{
+	errno = EBADF;
+	return NULL;
+}
+
+int iio_buffer_get_completion_fd(const struct iio_buffer *buf)
+{
+	return -EBADF;
+}
+
+int iio_buffer_release_block(struct iio_buffer *buf, struct iio_block *block)
+{
+	return -EBADF;
+}
+
+int iio_buffer_start_streaming(struct iio_buffer *buf,
+		unsigned int nb_blocks, enum iio_stream_overrun overrun)
+{
+	return -ENOSYS;
+}
+
+static void free_stream(struct iio_buffer *buf)
+{
+}
+
+ssize_t iio_buffer_stream_refill(struct iio_buffer *buf)
+{
+	return -ENOSYS;
+}
+
+void iio_buffer_stream_set_blocking_mode(struct iio_buffer *buf,
+		bool blocking)
+{
+}
+
+uint64_t iio_buffer_get_dropped_blocks(const struct iio_buffer *buf)
+{
+	return 0;
+}
+
+int iio_buffer_start_fanout(struct iio_buffer *buf, unsigned int nb_blocks)
+{
+	return -ENOSYS;
+}
+
+static void free_fanout(struct iio_buffer *buf)
+{
+}
+
+struct iio_buffer_consumer * iio_buffer_add_consumer(struct iio_buffer *buf,
+		unsigned int max_queued, enum iio_consumer_policy policy)
+{
+	errno = EBADF;
+	return NULL;
+}
+
+void iio_buffer_remove_consumer(struct iio_buffer_consumer *consumer)
+{
+}
+
+const struct iio_block * iio_buffer_consumer_get_block(
+		struct iio_buffer_consumer *consumer, bool wait)
+{
+	errno = EBADF;
+	return NULL;
+}
+
+void iio_buffer_consumer_release_block(struct iio_buffer_consumer *consumer,
+		const struct iio_block *block)
+{
+}
+
+uint64_t iio_buffer_consumer_get_dropped_blocks(
+		const struct iio_buffer_consumer *consumer)
+{
+	return 0;
+}
+
+#endif /* _WIN32 || NO_THREADS */
+
+static struct iio_block * get_dma_block(struct iio_buffer *buf,
+		unsigned int id)
+{
+	struct iio_block *block = NULL;
+
+	iio_mutex_lock(buf->dma_blocks_lock);
+
+	if (id >= buf->nb_dma_blocks) {
+		struct iio_block **blocks = realloc(buf->dma_blocks,
+				(id + 1) * sizeof(*blocks));
+
+		if (!blocks)
+			goto out_unlock;
+
+		memset(&blocks[buf->nb_dma_blocks], 0,
+				(id + 1 - buf->nb_dma_blocks) * sizeof(*blocks));
+		buf->dma_blocks = blocks;
+		buf->nb_dma_blocks = id + 1;
+	}
+
+	block = buf->dma_blocks[id];
+	if (!block) {
+		block = zalloc(sizeof(*block));
+		if (!block)
+			goto out_unlock;
+
+		block->buf = buf;
+		block->id = id;
+		block->mapped = true;
+		buf->dma_blocks[id] = block;
+	}
+
+	/* From now on, iio_buffer_release_dma_blocks won't free it */
+	block->state = BLOCK_USER;
+
+out_unlock:
+	iio_mutex_unlock(buf->dma_blocks_lock);
+	return block;
+}
+
+struct iio_block * iio_buffer_dequeue_block(struct iio_buffer *buf)
+{
+	const struct iio_device *dev = buf->dev;
+	const struct iio_backend_ops *ops = dev->ctx->ops;
+	struct iio_block *block;
+	unsigned int id;
+	void *addr;
+	ssize_t ret;
+
+	if (buf->async || buf->fanout) {
+		errno = EBUSY;
+		return NULL;
+	}
+
+	if (!buf->dev_is_high_speed ||
+			!ops->dequeue_block || !ops->enqueue_block) {
+		errno = ENOSYS;
+		return NULL;
+	}
+
+	ret = ops->dequeue_block(dev, &id, &addr);
+	if (ret < 0) {
+		errno = (int) -ret;
+		return NULL;
+	}
+
+	block = get_dma_block(buf, id);
+	if (!block) {
+		ops->enqueue_block(dev, id, buf->length);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	/* Output blocks are handed out empty, to be filled entirely */
+	block->addr = addr;
+	block->bytes_used = buf->is_output ? buf->length : (size_t) ret;
+	block->status = (ssize_t) block->bytes_used;
+	block->timestamp = iio_time_ns();
+	return block;
+}
+
+int iio_buffer_enqueue_block(struct iio_buffer *buf, struct iio_block *block)
+{
+	const struct iio_device *dev = buf->dev;
+	size_t bytes_used;
+	unsigned int id;
+	int ret;
+
+	if (buf->async)
+		return -EBUSY;
+	if (block->buf != buf)
+		return -EINVAL;
+
+	iio_mutex_lock(buf->dma_blocks_lock);
+
+	if (block->state != BLOCK_USER) {
+		iio_mutex_unlock(buf->dma_blocks_lock);
+		return -EINVAL;
+	}
+
+	/* The block may be dequeued again by another thread as soon as the
+	 * kernel has it, so it must be marked as free before that */
+	id = block->id;
+	bytes_used = buf->is_output ? block->bytes_used : buf->length;
+	block->state = BLOCK_FREE;
+
+	iio_mutex_unlock(buf->dma_blocks_lock);
+
+	ret = dev->ctx->ops->enqueue_block(dev, id, bytes_used);
+	if (ret < 0) {
+		/* Unless it was released in the meantime, the block is still
+		 * owned by the application */
+		iio_mutex_lock(buf->dma_blocks_lock);
+		if (id < buf->nb_dma_blocks && buf->dma_blocks[id] == block)
+			block->state = BLOCK_USER;
+		iio_mutex_unlock(buf->dma_blocks_lock);
+	}
+	return ret;
+}
+
+int iio_buffer_release_dma_blocks(struct iio_buffer *buf)
+{
+	unsigned int i;
+
+	/* Checked under the same lock as the blocks are freed, so that no
+	 * block can be dequeued in between */
+	iio_mutex_lock(buf->dma_blocks_lock);
+
+	if (dma_blocks_in_use_unlocked(buf)) {
+		iio_mutex_unlock(buf->dma_blocks_lock);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < buf->nb_dma_blocks; i++)
+		free(buf->dma_blocks[i]);
+	free(buf->dma_blocks);
+
+	buf->dma_blocks = NULL;
+	buf->nb_dma_blocks = 0;
+
+	iio_mutex_unlock(buf->dma_blocks_lock);
+	return 0;
+}
+
+void iio_buffer_free_blocks(struct iio_buffer *buf)
+{
+	unsigned int i;
+
+	free_async(buf);
+	free_stream(buf);
+	free_fanout(buf);
+
+	for (i = 0; i < buf->nb_dma_blocks; i++)
+		free(buf->dma_blocks[i]);
+	free(buf->dma_blocks);
+	iio_mutex_destroy(buf->dma_blocks_lock);
+}
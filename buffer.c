@@ -17,11 +17,23 @@
  * */
 
 #include "iio-config.h"
+#include "iio-lock.h"
 #include "iio-private.h"
 
 #include <errno.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+
 struct callback_wrapper_data {
 	ssize_t (*callback)(const struct iio_channel *, void *, size_t, void *);
 	void *data;
@@ -39,17 +51,139 @@ static bool device_is_high_speed(const struct iio_device *dev)
 		(ops->get_buffer(dev, NULL, 0, NULL, 0) != -ENOSYS);
 }
 
-struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
-		size_t samples_count, bool cyclic)
+/* Computes the position of every channel within one sample, so that
+ * iio_buffer_first() and iio_buffer_foreach_sample() don't have to walk the
+ * channel list and redo the alignment math on every call. */
+static void iio_buffer_update_layout(struct iio_buffer *buf)
+{
+	const struct iio_device *dev = buf->dev;
+	size_t ptr = 0, group_start = 0;
+	unsigned int i;
+
+	buf->nb_layout = 0;
+
+	for (i = 0; i < dev->nb_channels; i++) {
+		const struct iio_channel *chn = dev->channels[i];
+		unsigned int length = chn->format.length / 8,
+			     len = length * chn->format.repeat;
+		size_t offset;
+
+		/* NOTE: dev->channels are ordered by index */
+		if (chn->index < 0)
+			break;
+
+		/* Two channels with the same index use the same samples */
+		if (i == 0 || chn->index != dev->channels[i - 1]->index) {
+			group_start = ptr;
+
+			/* Test if the buffer has samples for this channel */
+			if (TEST_BIT(buf->mask, chn->index)) {
+				if (len && ptr % len)
+					ptr += len - (ptr % len);
+				ptr += len;
+			}
+		}
+
+		offset = group_start;
+		if (length && offset % length)
+			offset += length - (offset % length);
+		buf->offsets[chn->number] = offset;
+
+		if (TEST_BIT(buf->mask, chn->index)) {
+			struct iio_channel_layout *layout =
+				&buf->layout[buf->nb_layout++];
+
+			layout->chn = chn;
+			layout->offset = offset;
+			layout->length = length;
+			layout->repeat = chn->format.repeat;
+		}
+	}
+
+	memcpy(buf->layout_mask, buf->mask, dev->words * sizeof(*buf->mask));
+	buf->sample_size = iio_device_get_sample_size_mask(dev,
+			buf->mask, dev->words);
+}
+
+static int iio_buffer_alloc_layout(struct iio_buffer *buf)
+{
+	const struct iio_device *dev = buf->dev;
+
+	buf->offsets = calloc(dev->nb_channels, sizeof(*buf->offsets));
+	if (!buf->offsets)
+		return -ENOMEM;
+
+	buf->layout = calloc(dev->nb_channels, sizeof(*buf->layout));
+	if (!buf->layout)
+		goto err_free_offsets;
+
+	buf->layout_mask = calloc(dev->words, sizeof(*buf->layout_mask));
+	if (!buf->layout_mask)
+		goto err_free_layout;
+
+	return 0;
+
+err_free_layout:
+	free(buf->layout);
+err_free_offsets:
+	free(buf->offsets);
+	return -ENOMEM;
+}
+
+static void iio_buffer_free_layout(struct iio_buffer *buf)
+{
+	free(buf->layout_mask);
+	free(buf->layout);
+	free(buf->offsets);
+}
+
+/* Allocate the memory of a buffer on 2 MiB huge pages when possible:
+ * first from the pool of reserved huge pages, then as transparent huge
+ * pages, and finally as regular memory. */
+static void * alloc_hugepages(size_t len, size_t *mmap_length)
+{
+	size_t size = (len + HUGEPAGE_SIZE - 1) &
+		~(size_t) (HUGEPAGE_SIZE - 1);
+	void *ptr;
+
+	*mmap_length = 0;
+
+#ifdef MAP_HUGETLB
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (ptr != MAP_FAILED) {
+		*mmap_length = size;
+		return ptr;
+	}
+#endif
+
+#ifndef _WIN32
+	if (!posix_memalign(&ptr, HUGEPAGE_SIZE, size)) {
+#ifdef MADV_HUGEPAGE
+		madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+		return ptr;
+	}
+#endif
+
+	return malloc(len);
+}
+
+static struct iio_buffer * create_buffer(const struct iio_device *dev,
+		size_t samples_count, bool cyclic,
+		void *mem, size_t mem_len, bool hugepages)
 {
 	int ret = -EINVAL;
 	struct iio_buffer *buf;
-	unsigned int sample_size = iio_device_get_sample_size(dev);
+	unsigned int i, sample_size = iio_device_get_sample_size(dev);
 
 	if (!sample_size || !samples_count)
 		goto err_set_errno;
 
-	buf = malloc(sizeof(*buf));
+	if (mem && mem_len < sample_size * samples_count)
+		goto err_set_errno;
+
+	buf = zalloc(sizeof(*buf));
 	if (!buf) {
 		ret = -ENOMEM;
 		goto err_set_errno;
@@ -58,6 +192,9 @@ struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
 	buf->dev_sample_size = sample_size;
 	buf->length = sample_size * samples_count;
 	buf->dev = dev;
+	buf->is_output = iio_device_is_tx(dev);
+	buf->cyclic = cyclic;
+	buf->hugepages = hugepages;
 	buf->mask = calloc(dev->words, sizeof(*buf->mask));
 	if (!buf->mask) {
 		ret = -ENOMEM;
@@ -70,12 +207,41 @@ struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
 	 * iio_buffer_foreach_sample to be used. */
 	memcpy(buf->mask, dev->mask, dev->words * sizeof(*buf->mask));
 
-	ret = iio_device_open(dev, samples_count, cyclic);
+	ret = iio_buffer_alloc_layout(buf);
 	if (ret < 0)
 		goto err_free_mask;
 
+	buf->dma_blocks_lock = iio_mutex_create();
+	if (!buf->dma_blocks_lock) {
+		ret = -ENOMEM;
+		goto err_free_layout;
+	}
+
+	for (i = 0; i < dev->nb_channels; i++) {
+		const struct iio_channel *chn = dev->channels[i];
+
+		if (chn->type == IIO_TIMESTAMP && chn->index >= 0) {
+			buf->timestamp_chn = chn;
+			break;
+		}
+	}
+
+	/* Let the backend account for the events only it can see */
+	((struct iio_device *) dev)->buffer = buf;
+
+	ret = iio_device_open(dev, samples_count, cyclic);
+	if (ret < 0)
+		goto err_destroy_lock;
+
 	buf->dev_is_high_speed = device_is_high_speed(dev);
 	if (buf->dev_is_high_speed) {
+		/* The samples live in the kernel's DMA blocks: there is no way
+		 * to use the caller's memory instead. */
+		if (mem) {
+			ret = -ENOSYS;
+			goto err_close_device;
+		}
+
 		/* Dequeue the first buffer, so that buf->buffer is correctly
 		 * initialized */
 		buf->buffer = NULL;
@@ -85,21 +251,35 @@ struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
 			if (ret < 0)
 				goto err_close_device;
 		}
+	} else if (mem) {
+		buf->buffer = mem;
+		buf->user_memory = true;
+		buf->capacity = mem_len;
 	} else {
-		buf->buffer = malloc(buf->length);
+		if (hugepages)
+			buf->buffer = alloc_hugepages(buf->length,
+					&buf->mmap_length);
+		else
+			buf->buffer = malloc(buf->length);
 		if (!buf->buffer) {
 			ret = -ENOMEM;
 			goto err_close_device;
 		}
+
+		buf->capacity = buf->length;
 	}
 
-	buf->sample_size = iio_device_get_sample_size_mask(dev,
-			buf->mask, dev->words);
+	iio_buffer_update_layout(buf);
 	buf->data_length = buf->length;
 	return buf;
 
 err_close_device:
 	iio_device_close(dev);
+err_destroy_lock:
+	((struct iio_device *) dev)->buffer = NULL;
+	iio_mutex_destroy(buf->dma_blocks_lock);
+err_free_layout:
+	iio_buffer_free_layout(buf);
 err_free_mask:
 	free(buf->mask);
 err_free_buf:
@@ -109,11 +289,165 @@ err_set_errno:
 	return NULL;
 }
 
+struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
+		size_t samples_count, bool cyclic)
+{
+	return create_buffer(dev, samples_count, cyclic, NULL, 0, false);
+}
+
+struct iio_buffer * iio_device_create_buffer_with_memory(
+		const struct iio_device *dev, size_t samples_count,
+		bool cyclic, void *mem, size_t len)
+{
+	if (!mem) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return create_buffer(dev, samples_count, cyclic, mem, len, false);
+}
+
+struct iio_buffer * iio_device_create_buffer_hugepages(
+		const struct iio_device *dev, size_t samples_count, bool cyclic)
+{
+	return create_buffer(dev, samples_count, cyclic, NULL, 0, true);
+}
+
+/* Frees memory obtained with malloc() or alloc_hugepages() */
+static void free_samples(void *mem, size_t mmap_length)
+{
+#ifndef _WIN32
+	if (mmap_length)
+		munmap(mem, mmap_length);
+	else
+#endif
+		free(mem);
+}
+
+static void free_memory(struct iio_buffer *buffer)
+{
+#ifndef _WIN32
+	if (buffer->ring) {
+		munmap(buffer->ring, 2 * buffer->ring_size);
+		return;
+	}
+#endif
+
+	if (!buffer->dev_is_high_speed && !buffer->user_memory)
+		free_samples(buffer->buffer, buffer->mmap_length);
+}
+
+/* The device is left in an unknown state: close it, so that every further
+ * transfer fails until the buffer is destroyed */
+static void invalidate_buffer(struct iio_buffer *buffer)
+{
+	iio_device_close(buffer->dev);
+	buffer->cancelled = true;
+	buffer->data_length = 0;
+}
+
+int iio_buffer_reconfigure(struct iio_buffer *buffer, size_t samples_count)
+{
+	const struct iio_device *dev = buffer->dev;
+	const struct iio_backend_ops *ops = dev->ctx->ops;
+	unsigned int sample_size = iio_device_get_sample_size(dev);
+	size_t length = sample_size * samples_count;
+	bool was_high_speed = buffer->dev_is_high_speed;
+	size_t mmap_length = 0;
+	void *mem = NULL, *dev_mem = NULL;
+	int ret;
+
+	if (!sample_size || !samples_count)
+		return -EINVAL;
+
+	if (buffer->cancelled)
+		return -EBADF;
+	if (buffer->async || buffer->stream || buffer->fanout || buffer->ring)
+		return -EBUSY;
+
+	if (buffer->user_memory && length > buffer->capacity)
+		return -EINVAL;
+
+	/* The memory of the buffer is kept, so the device must keep the same
+	 * interface: only the backend's reconfigure operation guarantees it,
+	 * while closing and opening the device again might not */
+	if (was_high_speed && !ops->reconfigure)
+		return -ENOSYS;
+
+	/* Blocks handed out by iio_buffer_dequeue_block live in the kernel
+	 * buffer that is about to be reallocated */
+	ret = iio_buffer_release_dma_blocks(buffer);
+	if (ret < 0)
+		return ret;
+
+	/* Allocate before touching the device, so that failing to allocate
+	 * leaves the buffer usable */
+	if (!was_high_speed && !buffer->user_memory &&
+			length > buffer->capacity) {
+		if (buffer->hugepages)
+			mem = alloc_hugepages(length, &mmap_length);
+		else
+			mem = malloc(length);
+		if (!mem)
+			return -ENOMEM;
+	}
+
+	if (ops->reconfigure) {
+		ret = ops->reconfigure(dev, samples_count);
+	} else {
+		iio_device_close(dev);
+		ret = iio_device_open(dev, samples_count, buffer->cyclic);
+	}
+	if (ret < 0)
+		goto err_invalidate;
+
+	if (device_is_high_speed(dev) != was_high_speed) {
+		ret = -EIO;
+		goto err_invalidate;
+	}
+
+	if (was_high_speed && buffer->is_output) {
+		ret = ops->get_buffer(dev, &dev_mem, length,
+				dev->mask, dev->words);
+		if (ret < 0)
+			goto err_invalidate;
+	}
+
+	if (mem) {
+		free_memory(buffer);
+		buffer->buffer = mem;
+		buffer->mmap_length = mmap_length;
+		buffer->capacity = length;
+	} else if (was_high_speed) {
+		buffer->buffer = dev_mem;
+	}
+
+	buffer->dev_sample_size = sample_size;
+	buffer->length = length;
+	buffer->data_length = length;
+	buffer->timestamp = 0;
+	buffer->has_remote_latency = false;
+	memcpy(buffer->mask, dev->mask, dev->words * sizeof(*buffer->mask));
+
+	iio_buffer_update_layout(buffer);
+	return 0;
+
+err_invalidate:
+	invalidate_buffer(buffer);
+	if (mem)
+		free_samples(mem, mmap_length);
+	return ret;
+}
+
 void iio_buffer_destroy(struct iio_buffer *buffer)
 {
+	iio_buffer_free_blocks(buffer);
+	iio_buffer_free_decimators(buffer);
+	iio_buffer_free_capture(buffer);
 	iio_device_close(buffer->dev);
-	if (!buffer->dev_is_high_speed)
-		free(buffer->buffer);
+	((struct iio_device *) buffer->dev)->buffer = NULL;
+	free_memory(buffer);
+	iio_buffer_free_layout(buffer);
 	free(buffer->mask);
 	free(buffer);
 }
@@ -125,35 +459,238 @@ int iio_buffer_get_poll_fd(struct iio_buffer *buffer)
 
 int iio_buffer_set_blocking_mode(struct iio_buffer *buffer, bool blocking)
 {
+	/* The refill thread always waits for the device */
+	if (buffer->stream) {
+		iio_buffer_stream_set_blocking_mode(buffer, blocking);
+		return 0;
+	}
+
 	return iio_device_set_blocking_mode(buffer->dev, blocking);
 }
 
+static unsigned int latency_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int bucket = 0;
+
+	while (us && bucket < IIO_BUFFER_STATS_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+uint64_t iio_buffer_stats_update(struct iio_buffer *buf, bool is_push,
+		uint64_t start_ns, ssize_t ret)
+{
+	struct iio_buffer_stats *stats = &buf->stats;
+	uint64_t now = iio_time_ns();
+	unsigned int bucket = latency_bucket(now - start_ns);
+
+	/* The worker threads of the asynchronous and streaming modes update
+	 * the counters while the application may read or reset them */
+	if (is_push) {
+		__atomic_add_fetch(&stats->push_latency[bucket], 1,
+				__ATOMIC_RELAXED);
+	} else {
+		uint64_t last = __atomic_load_n(&buf->last_refill_ns,
+				__ATOMIC_RELAXED);
+
+		__atomic_add_fetch(&stats->refill_latency[bucket], 1,
+				__ATOMIC_RELAXED);
+
+		/* Refills are never done by two threads at once */
+		if (last && start_ns - last > __atomic_load_n(
+					&stats->max_refill_gap_ns,
+					__ATOMIC_RELAXED))
+			__atomic_store_n(&stats->max_refill_gap_ns,
+					start_ns - last, __ATOMIC_RELAXED);
+		__atomic_store_n(&buf->last_refill_ns, now, __ATOMIC_RELAXED);
+	}
+
+	if (ret >= 0) {
+		__atomic_add_fetch(&stats->bytes, (uint64_t) ret,
+				__ATOMIC_RELAXED);
+		__atomic_add_fetch(&stats->blocks, 1, __ATOMIC_RELAXED);
+	} else if (ret == -ETIMEDOUT) {
+		__atomic_add_fetch(&stats->timeouts, 1, __ATOMIC_RELAXED);
+	} else if (ret == -EAGAIN) {
+		__atomic_add_fetch(&stats->eagain, 1, __ATOMIC_RELAXED);
+	} else {
+		__atomic_add_fetch(&stats->errors, 1, __ATOMIC_RELAXED);
+	}
+
+	return now;
+}
+
+static ssize_t refill_done(struct iio_buffer *buffer,
+		uint64_t start_ns, ssize_t read)
+{
+	uint64_t now = iio_buffer_stats_update(buffer, false, start_ns, read);
+
+	if (read >= 0) {
+		buffer->data_length = read;
+
+		if (buffer->ring) {
+			buffer->buffer = buffer->ring + buffer->ring_head;
+			buffer->ring_head = (buffer->ring_head + read) %
+				buffer->ring_size;
+			buffer->ring_fill += read;
+			buffer->ring_total += read;
+			if (buffer->ring_fill > buffer->ring_size)
+				buffer->ring_fill = buffer->ring_size;
+		}
+
+		/* Streaming blocks carry the time they were completed at */
+		if (!buffer->stream)
+			buffer->timestamp = now;
+
+		if (memcmp(buffer->mask, buffer->layout_mask,
+					buffer->dev->words * sizeof(*buffer->mask)))
+			iio_buffer_update_layout(buffer);
+
+		if (buffer->nb_decimators) {
+			int ret = iio_buffer_run_decimators(buffer);
+
+			if (ret < 0)
+				return ret;
+		}
+	}
+	return read;
+}
+
+/* In ring mode, the samples go right after the previous ones */
+static void * refill_dest(const struct iio_buffer *buffer)
+{
+	return buffer->ring ? buffer->ring + buffer->ring_head :
+		buffer->buffer;
+}
+
 ssize_t iio_buffer_refill(struct iio_buffer *buffer)
 {
 	ssize_t read;
 	const struct iio_device *dev = buffer->dev;
+	uint64_t start_ns;
 
-	if (buffer->dev_is_high_speed) {
+	if (buffer->async || buffer->fanout)
+		return -EBUSY;
+
+	start_ns = iio_time_ns();
+
+	if (buffer->stream) {
+		read = iio_buffer_stream_refill(buffer);
+	} else if (buffer->dev_is_high_speed) {
 		read = dev->ctx->ops->get_buffer(dev, &buffer->buffer,
 				buffer->length, buffer->mask, dev->words);
+
+		/* The kernel's blocks are mapped separately */
+		if (read > 0 && buffer->ring)
+			memcpy(refill_dest(buffer), buffer->buffer, read);
 	} else {
-		read = iio_device_read_raw(dev, buffer->buffer, buffer->length,
+		read = iio_device_read_raw(dev, refill_dest(buffer),
+				buffer->length, buffer->mask, dev->words);
+	}
+
+	return refill_done(buffer, start_ns, read);
+}
+
+ssize_t iio_buffer_refill_min(struct iio_buffer *buffer, size_t min_samples)
+{
+	const struct iio_device *dev = buffer->dev;
+	size_t min_len = min_samples * buffer->dev_sample_size;
+	uint64_t start_ns;
+	ssize_t read;
+
+	if (!min_samples || min_len > buffer->length)
+		return -EINVAL;
+
+	/* Kernel blocks, and the blocks of the refill thread, are only
+	 * handed out once full */
+	if (buffer->async || buffer->stream || buffer->fanout ||
+			buffer->dev_is_high_speed)
+		return iio_buffer_refill(buffer);
+
+	start_ns = iio_time_ns();
+
+	/* The remote backends cannot tell how many samples are available:
+	 * they return exactly the minimum */
+	if (dev->ctx->ops->read_min)
+		read = dev->ctx->ops->read_min(dev, refill_dest(buffer),
+				buffer->length, min_len,
+				buffer->mask, dev->words);
+	else
+		read = iio_device_read_raw(dev, refill_dest(buffer), min_len,
 				buffer->mask, dev->words);
+
+	return refill_done(buffer, start_ns, read);
+}
+
+ssize_t iio_buffer_refill_stats(struct iio_buffer *buffer,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats)
+{
+	const struct iio_device *dev = buffer->dev;
+	struct iio_channel_stats *dev_stats;
+	uint64_t start_ns;
+	unsigned int i;
+	ssize_t read;
+	int ret;
+
+	/* Only a plain refill can be replaced by the summary */
+	if (!dev->ctx->ops->read_stats || buffer->dev_is_high_speed ||
+			buffer->async || buffer->stream || buffer->fanout ||
+			buffer->ring || buffer->nb_decimators)
+		goto refill_and_compute;
+
+	for (i = 0; i < nb_channels; i++)
+		if (chns[i]->dev != dev)
+			return -EINVAL;
+
+	dev_stats = calloc(dev->nb_channels, sizeof(*dev_stats));
+	if (!dev_stats)
+		return -ENOMEM;
+
+	start_ns = iio_time_ns();
+	read = dev->ctx->ops->read_stats(dev, buffer->length,
+			buffer->mask, dev->words, dev_stats);
+	if (read == -ENOSYS) {
+		free(dev_stats);
+		goto refill_and_compute;
 	}
 
+	read = refill_done(buffer, start_ns, read);
 	if (read >= 0) {
-		buffer->data_length = read;
-		buffer->sample_size = iio_device_get_sample_size_mask(dev,
-				buffer->mask, dev->words);
+		/* The samples themselves stayed on the remote side */
+		buffer->data_length = 0;
+
+		for (i = 0; i < nb_channels; i++)
+			stats[i] = dev_stats[chns[i]->number];
 	}
+
+	free(dev_stats);
 	return read;
+
+refill_and_compute:
+	read = iio_buffer_refill(buffer);
+	if (read < 0)
+		return read;
+
+	ret = iio_buffer_compute_stats(buffer, chns, nb_channels, stats);
+	return ret < 0 ? ret : read;
 }
 
 ssize_t iio_buffer_push(struct iio_buffer *buffer)
 {
 	const struct iio_device *dev = buffer->dev;
+	uint64_t start_ns;
 	ssize_t ret;
 
+	if (buffer->async)
+		return -EBUSY;
+
+	start_ns = iio_time_ns();
+
 	if (buffer->dev_is_high_speed) {
 		void *buf;
 		ret = dev->ctx->ops->get_buffer(dev, &buf,
@@ -181,6 +718,7 @@ ssize_t iio_buffer_push(struct iio_buffer *buffer)
 	}
 
 out_reset_data_length:
+	iio_buffer_stats_update(buffer, true, start_ns, ret);
 	buffer->data_length = buffer->length;
 	return ret;
 }
@@ -196,14 +734,128 @@ ssize_t iio_buffer_push_partial(struct iio_buffer *buffer, size_t samples_count)
 	return iio_buffer_push(buffer);
 }
 
-ssize_t iio_buffer_foreach_sample(struct iio_buffer *buffer,
-		ssize_t (*callback)(const struct iio_channel *,
-			void *, size_t, void *), void *d)
+#ifndef _WIN32
+static int ring_create_fd(size_t size)
+{
+	char path[] = "/tmp/libiio-ring-XXXXXX";
+	int fd = -1, ret;
+
+#ifdef __NR_memfd_create
+	fd = (int) syscall(__NR_memfd_create, "libiio-ring", 1 /* CLOEXEC */);
+#endif
+	if (fd < 0) {
+		fd = mkstemp(path);
+		if (fd < 0)
+			return -errno;
+		unlink(path);
+	}
+
+	if (ftruncate(fd, (off_t) size) < 0) {
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	return fd;
+}
+
+int iio_buffer_start_ring(struct iio_buffer *buffer, unsigned int nb_blocks)
 {
-	uintptr_t ptr = (uintptr_t) buffer->buffer,
-		  start = ptr,
-		  end = ptr + buffer->data_length;
+	size_t size, page = (size_t) sysconf(_SC_PAGESIZE);
+	char *ring;
+	int fd, ret;
+
+	if (buffer->async || buffer->stream || buffer->fanout || buffer->ring)
+		return -EBUSY;
+	if (buffer->is_output)
+		return -EPERM;
+	if (!nb_blocks)
+		return -EINVAL;
+
+	/* The mirror only works with whole pages; any size will do, since
+	 * a refill wrapping around the end lands in the mirror */
+	size = ((size_t) nb_blocks * buffer->length + page - 1) / page * page;
+
+	fd = ring_create_fd(size);
+	if (fd < 0)
+		return fd;
+
+	/* Reserve the address range first, so that nothing else can be
+	 * mapped between the two views */
+	ring = mmap(NULL, 2 * size, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED) {
+		ret = -errno;
+		goto err_close_fd;
+	}
+
+	if (mmap(ring, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+			mmap(ring + size, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		ret = -errno;
+		goto err_munmap;
+	}
+
+	close(fd);
+
+	free_memory(buffer);
+	buffer->mmap_length = 0;
+	buffer->capacity = 0;
+
+	buffer->ring = ring;
+	buffer->ring_size = size;
+	buffer->ring_head = 0;
+	buffer->ring_fill = 0;
+	buffer->ring_total = 0;
+	buffer->buffer = ring;
+	buffer->data_length = 0;
+	return 0;
+
+err_munmap:
+	munmap(ring, 2 * size);
+err_close_fd:
+	close(fd);
+	return ret;
+}
+#else
+int iio_buffer_start_ring(struct iio_buffer *buffer, unsigned int nb_blocks)
+{
+	return -ENOSYS;
+}
+#endif
+
+void * iio_buffer_ring_window(const struct iio_buffer *buffer,
+		size_t nb_samples)
+{
+	size_t len = nb_samples * buffer->sample_size;
+
+	if (!buffer->ring || !nb_samples || len > buffer->ring_fill) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* The window ends at the head, seen from the mirror */
+	return buffer->ring + buffer->ring_head + buffer->ring_size - len;
+}
+
+size_t iio_buffer_ring_get_samples_count(const struct iio_buffer *buffer)
+{
+	if (!buffer->ring || !buffer->sample_size)
+		return 0;
+
+	return buffer->ring_fill / buffer->sample_size;
+}
+
+ssize_t iio_buffer_foreach_block(struct iio_buffer *buffer,
+		ssize_t (*callback)(const struct iio_channel *, void *,
+			ptrdiff_t, size_t, void *),
+		size_t block_size, void *d)
+{
+	uintptr_t ptr = (uintptr_t) buffer->buffer;
+	ptrdiff_t step = (ptrdiff_t) buffer->sample_size;
 	const struct iio_device *dev = buffer->dev;
+	size_t i, count, nb_samples;
 	ssize_t processed = 0;
 
 	if (buffer->sample_size == 0)
@@ -212,82 +864,256 @@ ssize_t iio_buffer_foreach_sample(struct iio_buffer *buffer,
 	if (buffer->data_length < buffer->dev_sample_size)
 		return 0;
 
-	while (end - ptr >= (size_t) buffer->sample_size) {
-		unsigned int i;
+	nb_samples = buffer->data_length / step;
+	if (!block_size)
+		block_size = nb_samples;
 
-		for (i = 0; i < dev->nb_channels; i++) {
-			const struct iio_channel *chn = dev->channels[i];
-			unsigned int length = chn->format.length / 8;
+	for (i = 0; i < nb_samples; i += count, ptr += count * step) {
+		unsigned int j;
 
-			if (chn->index < 0)
-				break;
+		count = nb_samples - i;
+		if (count > block_size)
+			count = block_size;
 
-			/* Test if the buffer has samples for this channel */
-			if (!TEST_BIT(buffer->mask, chn->index))
-				continue;
-
-			if ((ptr - start) % length)
-				ptr += length - ((ptr - start) % length);
+		for (j = 0; j < buffer->nb_layout; j++) {
+			const struct iio_channel_layout *layout =
+				&buffer->layout[j];
+			const struct iio_channel *chn = layout->chn;
+			ssize_t ret;
 
 			/* Test if the client wants samples from this channel */
-			if (TEST_BIT(dev->mask, chn->index)) {
-				ssize_t ret = callback(chn,
-						(void *) ptr, length, d);
-				if (ret < 0)
-					return ret;
-				else
-					processed += ret;
-			}
+			if (!TEST_BIT(dev->mask, chn->index))
+				continue;
 
-			if (i == dev->nb_channels - 1 || dev->channels[
-					i + 1]->index != chn->index)
-				ptr += length * chn->format.repeat;
+			ret = callback(chn, (void *) (ptr + layout->offset),
+					step, count, d);
+			if (ret < 0)
+				return ret;
+			else
+				processed += ret;
 		}
 	}
 	return processed;
 }
 
-void * iio_buffer_start(const struct iio_buffer *buffer)
+struct foreach_sample_info {
+	ssize_t (*callback)(const struct iio_channel *, void *, size_t, void *);
+	void *d;
+};
+
+static ssize_t foreach_sample_cb(const struct iio_channel *chn, void *src,
+		ptrdiff_t step, size_t count, void *d)
 {
-	return buffer->buffer;
+	struct foreach_sample_info *info = d;
+
+	return info->callback(chn, src, chn->format.length / 8, info->d);
 }
 
-void * iio_buffer_first(const struct iio_buffer *buffer,
-		const struct iio_channel *chn)
+ssize_t iio_buffer_foreach_sample(struct iio_buffer *buffer,
+		ssize_t (*callback)(const struct iio_channel *,
+			void *, size_t, void *), void *d)
 {
-	size_t len;
-	unsigned int i;
-	uintptr_t ptr = (uintptr_t) buffer->buffer,
-		  start = ptr;
+	struct foreach_sample_info info = {
+		.callback = callback,
+		.d = d,
+	};
 
-	if (!iio_channel_is_enabled(chn))
-		return iio_buffer_end(buffer);
+	/* One sample per block gives the same order of callbacks as before */
+	return iio_buffer_foreach_block(buffer, foreach_sample_cb, 1, &info);
+}
 
-	for (i = 0; i < buffer->dev->nb_channels; i++) {
-		struct iio_channel *cur = buffer->dev->channels[i];
-		len = cur->format.length / 8 * cur->format.repeat;
+/* Samples are processed in tiles, so that the part of the buffer being read
+ * stays in the cache while it is scattered to each channel, and so that each
+ * destination receives runs of whole cache lines. */
+#define DEINTERLEAVE_TILE 64
 
-		/* NOTE: dev->channels are ordered by index */
-		if (cur->index < 0 || cur->index == chn->index)
-			break;
+void iio_copy_strided(uintptr_t dst, ptrdiff_t dst_step,
+		uintptr_t src, ptrdiff_t src_step,
+		unsigned int length, size_t count)
+{
+	size_t i;
+
+	switch (length) {
+	case 1:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 1);
+		break;
+	case 2:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 2);
+		break;
+	case 4:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 4);
+		break;
+	case 8:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 8);
+		break;
+	/* Three-axis and quaternion channels with a repeat count */
+	case 6:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 6);
+		break;
+	case 12:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 12);
+		break;
+	case 16:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, 16);
+		break;
+	default:
+		for (i = 0; i < count; i++, src += src_step, dst += dst_step)
+			memcpy((void *) dst, (const void *) src, length);
+		break;
+	}
+}
 
-		/* Test if the buffer has samples for this channel */
-		if (!TEST_BIT(buffer->mask, cur->index))
-			continue;
+ssize_t iio_buffer_deinterleave(struct iio_buffer *buffer,
+		struct iio_channel * const *chns, void * const *dsts,
+		unsigned int nb, size_t samples_count, bool convert)
+{
+	uintptr_t start = (uintptr_t) buffer->buffer;
+	ptrdiff_t step = (ptrdiff_t) buffer->sample_size;
+	size_t i, j, tile, nb_samples;
+	unsigned int k;
 
-		/* Two channels with the same index use the same samples */
-		if (i > 0 && cur->index == buffer->dev->channels[i - 1]->index)
-			continue;
+	if (!nb || !step)
+		return -EINVAL;
 
-		if ((ptr - start) % len)
-			ptr += len - ((ptr - start) % len);
-		ptr += len;
+	for (k = 0; k < nb; k++) {
+		if (chns[k]->dev != buffer->dev ||
+				!iio_channel_is_enabled(chns[k]))
+			return -EINVAL;
 	}
 
-	len = chn->format.length / 8;
-	if ((ptr - start) % len)
-		ptr += len - ((ptr - start) % len);
-	return (void *) ptr;
+	nb_samples = buffer->data_length / step;
+	if (nb_samples > samples_count)
+		nb_samples = samples_count;
+
+	for (i = 0; i < nb_samples; i += tile) {
+		tile = nb_samples - i;
+		if (tile > DEINTERLEAVE_TILE)
+			tile = DEINTERLEAVE_TILE;
+
+		for (k = 0; k < nb; k++) {
+			const struct iio_channel *chn = chns[k];
+			unsigned int length = chn->format.length / 8 *
+				chn->format.repeat;
+			uintptr_t src = start + i * step +
+				buffer->offsets[chn->number];
+			uintptr_t dst = (uintptr_t) dsts[k] + i * length;
+
+			if (!convert || chn->convert.convert) {
+				iio_copy_strided(dst, length, src, step,
+						length, tile);
+				if (convert)
+					chn->convert.convert(&chn->convert,
+						(void *) dst, (const void *) dst,
+						tile * chn->format.repeat);
+				continue;
+			}
+
+			for (j = 0; j < tile; j++, src += step, dst += length)
+				iio_channel_convert(chn, (void *) dst,
+						(const void *) src);
+		}
+	}
+
+	return (ssize_t) nb_samples;
+}
+
+/* Bounce area receiving one channel's converted tile before it is scattered
+ * into the buffer */
+#define INTERLEAVE_TMP_SIZE 4096
+
+ssize_t iio_buffer_interleave(struct iio_buffer *buffer,
+		struct iio_channel * const *chns, const void * const *srcs,
+		unsigned int nb, size_t samples_count, bool is_float)
+{
+	uintptr_t start = (uintptr_t) buffer->buffer;
+	ptrdiff_t step = (ptrdiff_t) buffer->sample_size;
+	uint64_t tmp[INTERLEAVE_TMP_SIZE / sizeof(uint64_t)];
+	size_t i, tile, max_tile = DEINTERLEAVE_TILE, nb_samples;
+	size_t src_size = is_float ? sizeof(float) : sizeof(int16_t);
+	unsigned int k;
+
+	if (!nb || !step)
+		return -EINVAL;
+
+	for (k = 0; k < nb; k++) {
+		const struct iio_channel *chn = chns[k];
+		unsigned int length = chn->format.length / 8 *
+			chn->format.repeat;
+
+		if (chn->dev != buffer->dev || !iio_channel_is_enabled(chn) ||
+				!length || length > sizeof(tmp))
+			return -EINVAL;
+		if (!chn->convert.from_float)
+			return -ENOSYS;
+
+		if (max_tile > sizeof(tmp) / length)
+			max_tile = sizeof(tmp) / length;
+	}
+
+	nb_samples = buffer->data_length / step;
+	if (nb_samples > samples_count)
+		nb_samples = samples_count;
+
+	for (i = 0; i < nb_samples; i += tile) {
+		tile = nb_samples - i;
+		if (tile > max_tile)
+			tile = max_tile;
+
+		for (k = 0; k < nb; k++) {
+			const struct iio_channel *chn = chns[k];
+			const struct iio_convert_plan *plan = &chn->convert;
+			unsigned int repeat = chn->format.repeat,
+				     length = chn->format.length / 8 * repeat;
+			uintptr_t dst = start + i * step +
+				buffer->offsets[chn->number];
+			uintptr_t src = (uintptr_t) srcs[k] +
+				i * repeat * src_size;
+			void *out = tmp;
+			float scale;
+
+			/* A lone channel is written to the buffer directly */
+			if (step == (ptrdiff_t) length)
+				out = (void *) dst;
+
+			if (is_float) {
+				scale = (float) iio_channel_get_scale(chn);
+				plan->from_float(plan, out, (const float *) src,
+						tile * repeat, scale);
+			} else {
+				plan->from_int16(plan, out,
+						(const int16_t *) src,
+						tile * repeat);
+			}
+
+			if (out == tmp)
+				iio_copy_strided(dst, step, (uintptr_t) tmp,
+						length, length, tile);
+		}
+	}
+
+	return (ssize_t) nb_samples;
+}
+
+void * iio_buffer_start(const struct iio_buffer *buffer)
+{
+	return buffer->buffer;
+}
+
+void * iio_buffer_first(const struct iio_buffer *buffer,
+		const struct iio_channel *chn)
+{
+	if (!iio_channel_is_enabled(chn))
+		return iio_buffer_end(buffer);
+
+	return (void *) ((uintptr_t) buffer->buffer +
+			buffer->offsets[chn->number]);
 }
 
 ptrdiff_t iio_buffer_step(const struct iio_buffer *buffer)
@@ -319,6 +1145,79 @@ void iio_buffer_cancel(struct iio_buffer *buf)
 {
 	const struct iio_backend_ops *ops = buf->dev->ctx->ops;
 
-	if (ops->cancel)
+	if (ops->cancel) {
 		ops->cancel(buf->dev);
+		buf->cancelled = true;
+		__atomic_add_fetch(&buf->stats.cancellations, 1,
+				__ATOMIC_RELAXED);
+	}
+}
+
+/* Every field of struct iio_buffer_stats is a uint64_t counter */
+#define STATS_NB_COUNTERS (sizeof(struct iio_buffer_stats) / sizeof(uint64_t))
+
+void iio_buffer_get_stats(const struct iio_buffer *buf,
+		struct iio_buffer_stats *stats)
+{
+	const uint64_t *src = (const uint64_t *) &buf->stats;
+	uint64_t *dst = (uint64_t *) stats;
+	unsigned int i;
+
+	for (i = 0; i < STATS_NB_COUNTERS; i++)
+		dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+
+	stats->dropped = iio_buffer_get_dropped_blocks(buf);
+}
+
+void iio_buffer_reset_stats(struct iio_buffer *buf)
+{
+	uint64_t *counters = (uint64_t *) &buf->stats;
+	unsigned int i;
+
+	for (i = 0; i < STATS_NB_COUNTERS; i++)
+		__atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&buf->last_refill_ns, 0, __ATOMIC_RELAXED);
+}
+
+uint64_t iio_buffer_get_timestamp(const struct iio_buffer *buf)
+{
+	return buf->timestamp;
+}
+
+int iio_buffer_get_remote_latency(const struct iio_buffer *buf,
+		uint64_t *server_ns, uint64_t *transport_ns)
+{
+	if (!buf->has_remote_latency)
+		return -ENOSYS;
+
+	if (server_ns)
+		*server_ns = buf->server_latency_ns;
+	if (transport_ns)
+		*transport_ns = buf->transport_latency_ns;
+	return 0;
+}
+
+int iio_buffer_get_sample_timestamps(const struct iio_buffer *buf,
+		int64_t *first, int64_t *last)
+{
+	const struct iio_channel *chn = buf->timestamp_chn;
+	size_t nb_samples;
+	uintptr_t ptr;
+
+	if (!chn || !TEST_BIT(buf->mask, chn->number))
+		return -ENOENT;
+
+	nb_samples = buf->sample_size ?
+		buf->data_length / buf->sample_size : 0;
+	if (!nb_samples)
+		return -ENODATA;
+
+	ptr = (uintptr_t) buf->buffer + buf->offsets[chn->number];
+	if (first)
+		iio_channel_convert(chn, first, (const void *) ptr);
+	if (last)
+		iio_channel_convert(chn, last, (const void *) (ptr +
+					(nb_samples - 1) * buf->sample_size));
+	return 0;
 }
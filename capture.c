@@ -0,0 +1,209 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include "iio-private.h"
+
+#include <errno.h>
+#include <string.h>
+
+/*
+ * Triggered captures: the buffer runs in ring mode, and the ring is large
+ * enough to hold the pre-trigger samples, the post-trigger samples and one
+ * refill. The samples of the trigger channel are converted to floats one
+ * tile at a time as they arrive and scanned with the comparator; once the
+ * trigger fired and enough samples followed it, the window is returned in
+ * place from the ring. Samples are counted from the start of the ring, so
+ * that refills done by the application in between are scanned too.
+ */
+
+/* Number of samples converted and scanned at once */
+#define CAPTURE_TILE 256
+
+struct iio_capture {
+	const struct iio_channel *chn;
+	iio_trigger_kernel scan;
+	enum iio_trigger_mode mode;
+	float threshold;
+	size_t pre, post;
+
+	/* Next sample to scan, first sample the trigger may fire at, and the
+	 * sample it fired at */
+	uint64_t scan_pos, armed_pos, trigger_pos;
+	bool triggered;
+
+	/* Set when the sample before 'scan_pos' was not converted */
+	bool no_prev;
+
+	/* The sample before the tile, followed by the tile */
+	float work[CAPTURE_TILE + 1];
+};
+
+static uintptr_t sample_ptr(const struct iio_buffer *buf,
+		uint64_t pos, uint64_t total)
+{
+	/* Counted back from the head, as seen from the mirror */
+	return (uintptr_t) buf->ring + buf->ring_head + buf->ring_size -
+		(size_t) (total - pos) * buf->sample_size;
+}
+
+int iio_buffer_start_capture(struct iio_buffer *buf,
+		const struct iio_channel *chn, enum iio_trigger_mode mode,
+		double threshold, size_t pre_samples, size_t post_samples)
+{
+	size_t samples_count = buf->length / buf->dev_sample_size;
+	size_t needed = pre_samples + post_samples + samples_count;
+	struct iio_capture *cap;
+	int ret;
+
+	if (buf->capture)
+		return -EBUSY;
+	if (!post_samples || chn->dev != buf->dev ||
+			!iio_channel_is_enabled(chn) ||
+			chn->format.repeat > 1 || mode > IIO_TRIGGER_LOW)
+		return -EINVAL;
+	if (!chn->convert.to_float)
+		return -ENOSYS;
+
+	if (!buf->ring) {
+		ret = iio_buffer_start_ring(buf, (unsigned int)
+				((needed + samples_count - 1) / samples_count));
+		if (ret < 0)
+			return ret;
+	} else if (buf->ring_size / buf->sample_size < needed) {
+		return -ENOSPC;
+	}
+
+	cap = zalloc(sizeof(*cap));
+	if (!cap)
+		return -ENOMEM;
+
+	cap->chn = chn;
+	cap->scan = iio_get_trigger_kernel();
+	cap->mode = mode;
+	cap->threshold = (float) threshold;
+	cap->pre = pre_samples;
+	cap->post = post_samples;
+	cap->scan_pos = buf->ring_total / buf->sample_size;
+	cap->armed_pos = cap->scan_pos + pre_samples;
+	cap->no_prev = true;
+
+	buf->capture = cap;
+	return 0;
+}
+
+void iio_buffer_free_capture(struct iio_buffer *buf)
+{
+	free(buf->capture);
+	buf->capture = NULL;
+}
+
+/* Scans the samples refilled since the last call; returns true if the
+ * trigger fired */
+static bool capture_scan(struct iio_buffer *buf, struct iio_capture *cap,
+		uint64_t total)
+{
+	const struct iio_convert_plan *plan = &cap->chn->convert;
+	unsigned int length = cap->chn->format.length / 8;
+	ptrdiff_t step = (ptrdiff_t) buf->sample_size;
+	size_t offset = buf->offsets[cap->chn->number];
+	uint64_t oldest = total - buf->ring_fill / buf->sample_size;
+	uint64_t tmp[CAPTURE_TILE];
+	size_t n, idx;
+
+	/* The application refilled faster than we scanned */
+	if (cap->scan_pos < oldest) {
+		cap->scan_pos = oldest;
+		cap->no_prev = true;
+	}
+
+	while (cap->scan_pos < total) {
+		uintptr_t src = sample_ptr(buf, cap->scan_pos, total) + offset;
+
+		n = (size_t) (total - cap->scan_pos);
+		if (n > CAPTURE_TILE)
+			n = CAPTURE_TILE;
+
+		iio_copy_strided((uintptr_t) tmp, length, src, step,
+				length, n);
+		plan->to_float(plan, cap->work + 1, tmp, n, 1.0f);
+		if (cap->no_prev) {
+			cap->work[0] = cap->work[1];
+			cap->no_prev = false;
+		}
+
+		/* Hits before the trigger is armed again are ignored */
+		idx = 0;
+		if (cap->scan_pos + n > cap->armed_pos) {
+			if (cap->scan_pos < cap->armed_pos)
+				idx = (size_t) (cap->armed_pos - cap->scan_pos);
+			idx += cap->scan(cap->work + 1 + idx, n - idx,
+					cap->threshold, cap->mode);
+		} else {
+			idx = n;
+		}
+
+		if (idx < n) {
+			cap->trigger_pos = cap->scan_pos + idx;
+			cap->triggered = true;
+			cap->work[0] = cap->work[1 + idx];
+			cap->scan_pos += idx + 1;
+			return true;
+		}
+
+		cap->work[0] = cap->work[n];
+		cap->scan_pos += n;
+	}
+
+	return false;
+}
+
+ssize_t iio_buffer_capture(struct iio_buffer *buf, void **start)
+{
+	struct iio_capture *cap = buf->capture;
+	uint64_t total;
+	ssize_t ret;
+
+	if (!cap || !start)
+		return -EINVAL;
+
+	for (;;) {
+		total = buf->ring_total / buf->sample_size;
+
+		/* The pre-trigger samples were overwritten by refills of the
+		 * application: wait for the next trigger */
+		if (cap->triggered && cap->trigger_pos - cap->pre <
+				total - buf->ring_fill / buf->sample_size)
+			cap->triggered = false;
+
+		if (cap->triggered || capture_scan(buf, cap, total)) {
+			if (total >= cap->trigger_pos + cap->post) {
+				*start = (void *) sample_ptr(buf,
+						cap->trigger_pos - cap->pre,
+						total);
+				cap->triggered = false;
+				cap->armed_pos = cap->trigger_pos + cap->post;
+				return (ssize_t) ((cap->pre + cap->post) *
+						buf->sample_size);
+			}
+		}
+
+		ret = iio_buffer_refill(buf);
+		if (ret < 0)
+			return ret;
+	}
+}
@@ -147,19 +147,9 @@ void iio_channel_init_finalize(struct iio_channel *chn)
 
 	mod++;
 
-	for (i = 0; i < ARRAY_SIZE(modifier_names); i++) {
-		if (!modifier_names[i])
-			continue;
-		len = strlen(modifier_names[i]);
-		if (strncmp(modifier_names[i], mod, len) != 0)
-			continue;
-		/* Modifier must be followed by a '_' */
-		if (mod[len] != '_')
-			continue;
-
-		chn->modifier = (enum iio_modifier) i;
-		break;
-	}
+	/* The modifier ends the ID (e.g. "voltage0_i"), or is followed by
+	 * a '_' */
+	chn->modifier = (enum iio_modifier) find_channel_modifier(mod, NULL);
 }
 
 static char *get_attr_xml(struct iio_channel_attr *attr, size_t *length)
@@ -426,6 +416,12 @@ void free_channel(struct iio_channel *chn)
 	free(chn);
 }
 
+/* Number of bytes converted at once by iio_channel_read/iio_channel_write */
+#define CONVERT_TILE_SIZE 4096
+
+/* Number of I/Q samples converted at once by iio_channel_read_iq_* */
+#define IQ_TILE 256
+
 static void byte_swap(uint8_t *dst, const uint8_t *src, size_t len)
 {
 	size_t i;
@@ -532,6 +528,12 @@ void iio_channel_convert(const struct iio_channel *chn,
 	bool swap = !chn->format.is_be;
 #endif
 
+	if (chn->convert.convert) {
+		chn->convert.convert(&chn->convert, dst, src,
+				chn->format.repeat);
+		return;
+	}
+
 	for (src_ptr = (uintptr_t) src; src_ptr < end_ptr;
 			src_ptr += len, dst_ptr += len) {
 		if (len == 1 || !swap)
@@ -569,6 +571,12 @@ void iio_channel_convert_inverse(const struct iio_channel *chn,
 #endif
 	uint8_t buf[1024];
 
+	if (chn->convert.convert_inverse) {
+		chn->convert.convert_inverse(&chn->convert, dst, src,
+				chn->format.repeat);
+		return;
+	}
+
 	/* Somehow I doubt we will have samples of 8192 bits each. */
 	if (len > sizeof(buf))
 		return;
@@ -610,15 +618,96 @@ size_t iio_channel_read(const struct iio_channel *chn,
 	unsigned int length = chn->format.length / 8 * chn->format.repeat;
 	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
 	ptrdiff_t buf_step = iio_buffer_step(buf);
+	size_t i, tile, nb;
+
+	if (buf->nb_decimators) {
+		ssize_t ret = iio_buffer_read_decimated(buf, chn, dst, len,
+				IIO_DECIMATED_CPU);
+
+		if (ret != -ENOENT)
+			return (size_t) ret;
+	}
+
+	src_ptr = (uintptr_t) iio_buffer_first(buf, chn);
+
+	if (!chn->convert.convert || !length ||
+			length > CONVERT_TILE_SIZE || src_ptr >= buf_end) {
+		for (; src_ptr < buf_end && dst_ptr + length <= end;
+				src_ptr += buf_step, dst_ptr += length)
+			iio_channel_convert(chn,
+					(void *) dst_ptr, (const void *) src_ptr);
+		return dst_ptr - (uintptr_t) dst;
+	}
+
+	/* Gather the raw samples into the destination, then convert them
+	 * in place, one tile at a time so that they are still in the cache
+	 * when the conversion kernel runs. */
+	nb = (buf_end - src_ptr + buf_step - 1) / buf_step;
+	if (nb > len / length)
+		nb = len / length;
+
+	for (i = 0; i < nb; i += tile) {
+		tile = nb - i;
+		if (tile > CONVERT_TILE_SIZE / length)
+			tile = CONVERT_TILE_SIZE / length;
+
+		iio_copy_strided(dst_ptr, length, src_ptr, buf_step,
+				length, tile);
+		chn->convert.convert(&chn->convert, (void *) dst_ptr,
+				(const void *) dst_ptr,
+				tile * chn->format.repeat);
+
+		src_ptr += tile * buf_step;
+		dst_ptr += tile * length;
+	}
 
-	for (src_ptr = (uintptr_t) iio_buffer_first(buf, chn);
-			src_ptr < buf_end && dst_ptr + length <= end;
-			src_ptr += buf_step, dst_ptr += length)
-		iio_channel_convert(chn,
-				(void *) dst_ptr, (const void *) src_ptr);
 	return dst_ptr - (uintptr_t) dst;
 }
 
+ssize_t iio_channel_unpack(const struct iio_channel *chn,
+		void * const *dsts, const void *src, ptrdiff_t step,
+		size_t nb_samples)
+{
+	const struct iio_convert_plan *plan = &chn->convert;
+	unsigned int k, width = chn->format.length / 8,
+		     repeat = chn->format.repeat;
+	uintptr_t src_ptr = (uintptr_t) src;
+	size_t i, tile;
+
+	if (!dsts || !src || !width || !repeat)
+		return -EINVAL;
+	if (!plan->convert)
+		return -ENOSYS;
+
+	/* Contiguous samples: nothing to gather */
+	if (repeat == 1 && step == (ptrdiff_t) width) {
+		plan->convert(plan, dsts[0], src, nb_samples);
+		return (ssize_t) nb_samples;
+	}
+
+	/* Each element is gathered into its own array, then converted there
+	 * while the tile is still in the cache: the kernels always work on
+	 * contiguous values, whatever the repeat count and the step. */
+	for (i = 0; i < nb_samples; i += tile) {
+		tile = nb_samples - i;
+		if (tile > CONVERT_TILE_SIZE / width)
+			tile = CONVERT_TILE_SIZE / width;
+
+		for (k = 0; k < repeat; k++) {
+			uintptr_t dst = (uintptr_t) dsts[k] + i * width;
+
+			iio_copy_strided(dst, width, src_ptr + k * width,
+					step, width, tile);
+			plan->convert(plan, (void *) dst,
+					(const void *) dst, tile);
+		}
+
+		src_ptr += tile * step;
+	}
+
+	return (ssize_t) nb_samples;
+}
+
 size_t iio_channel_write_raw(const struct iio_channel *chn,
 		struct iio_buffer *buf, const void *src, size_t len)
 {
@@ -641,15 +730,388 @@ size_t iio_channel_write(const struct iio_channel *chn,
 	unsigned int length = chn->format.length / 8 * chn->format.repeat;
 	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
 	ptrdiff_t buf_step = iio_buffer_step(buf);
+	uint64_t tmp[CONVERT_TILE_SIZE / sizeof(uint64_t)];
+	size_t i, tile, nb;
+
+	dst_ptr = (uintptr_t) iio_buffer_first(buf, chn);
+
+	if (!chn->convert.convert_inverse || !length ||
+			length > CONVERT_TILE_SIZE || dst_ptr >= buf_end) {
+		for (; dst_ptr < buf_end && src_ptr + length <= end;
+				dst_ptr += buf_step, src_ptr += length)
+			iio_channel_convert_inverse(chn,
+					(void *) dst_ptr, (const void *) src_ptr);
+		return src_ptr - (uintptr_t) src;
+	}
+
+	/* Convert a tile of samples into a bounce buffer, then scatter it
+	 * into the interleaved buffer. */
+	nb = (buf_end - dst_ptr + buf_step - 1) / buf_step;
+	if (nb > len / length)
+		nb = len / length;
+
+	for (i = 0; i < nb; i += tile) {
+		tile = nb - i;
+		if (tile > CONVERT_TILE_SIZE / length)
+			tile = CONVERT_TILE_SIZE / length;
+
+		chn->convert.convert_inverse(&chn->convert, tmp,
+				(const void *) src_ptr,
+				tile * chn->format.repeat);
+		iio_copy_strided(dst_ptr, buf_step, (uintptr_t) tmp, length,
+				length, tile);
+
+		dst_ptr += tile * buf_step;
+		src_ptr += tile * length;
+	}
 
-	for (dst_ptr = (uintptr_t) iio_buffer_first(buf, chn);
-			dst_ptr < buf_end && src_ptr + length <= end;
-			dst_ptr += buf_step, src_ptr += length)
-		iio_channel_convert_inverse(chn,
-				(void *) dst_ptr, (const void *) src_ptr);
 	return src_ptr - (uintptr_t) src;
 }
 
+double iio_channel_get_scale(const struct iio_channel *chn)
+{
+	return chn->format.with_scale ? chn->format.scale : 1.0;
+}
+
+static ssize_t read_scaled(const struct iio_channel *chn,
+		struct iio_buffer *buf, void *dst, size_t len, bool is_double)
+{
+	const struct iio_convert_plan *plan = &chn->convert;
+	unsigned int length = chn->format.length / 8 * chn->format.repeat;
+	size_t out_len = chn->format.repeat *
+		(is_double ? sizeof(double) : sizeof(float));
+	uintptr_t src_ptr, dst_ptr = (uintptr_t) dst;
+	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
+	ptrdiff_t buf_step = iio_buffer_step(buf);
+	uint64_t tmp[CONVERT_TILE_SIZE / sizeof(uint64_t)];
+	double scale;
+	size_t i, tile, nb;
+
+	if (buf->nb_decimators) {
+		ssize_t ret = iio_buffer_read_decimated(buf, chn, dst, len,
+				is_double ? IIO_DECIMATED_DOUBLE :
+				IIO_DECIMATED_FLOAT);
+
+		if (ret != -ENOENT)
+			return ret;
+	}
+
+	if (!plan->to_float || !length || length > CONVERT_TILE_SIZE)
+		return -ENOSYS;
+
+	scale = iio_channel_get_scale(chn);
+	src_ptr = (uintptr_t) iio_buffer_first(buf, chn);
+	if (src_ptr >= buf_end)
+		return 0;
+
+	nb = (buf_end - src_ptr + buf_step - 1) / buf_step;
+	if (nb > len / out_len)
+		nb = len / out_len;
+
+	for (i = 0; i < nb; i += tile) {
+		const void *raw = tmp;
+
+		tile = nb - i;
+		if (tile > CONVERT_TILE_SIZE / length)
+			tile = CONVERT_TILE_SIZE / length;
+
+		/* Only gather the samples when they are not contiguous */
+		if (buf_step == (ptrdiff_t) length)
+			raw = (const void *) src_ptr;
+		else
+			iio_copy_strided((uintptr_t) tmp, length,
+					src_ptr, buf_step, length, tile);
+
+		if (is_double)
+			plan->to_double(plan, (double *) dst_ptr, raw,
+					tile * chn->format.repeat, scale);
+		else
+			plan->to_float(plan, (float *) dst_ptr, raw,
+					tile * chn->format.repeat,
+					(float) scale);
+
+		src_ptr += tile * buf_step;
+		dst_ptr += tile * out_len;
+	}
+
+	return dst_ptr - (uintptr_t) dst;
+}
+
+ssize_t iio_channel_read_float(const struct iio_channel *chn,
+		struct iio_buffer *buf, float *dst, size_t len)
+{
+	return read_scaled(chn, buf, dst, len, false);
+}
+
+ssize_t iio_channel_read_double(const struct iio_channel *chn,
+		struct iio_buffer *buf, double *dst, size_t len)
+{
+	return read_scaled(chn, buf, dst, len, true);
+}
+
+ssize_t iio_channel_write_float(const struct iio_channel *chn,
+		struct iio_buffer *buf, const float *src, size_t len)
+{
+	const struct iio_convert_plan *plan = &chn->convert;
+	unsigned int length = chn->format.length / 8 * chn->format.repeat;
+	size_t in_len = chn->format.repeat * sizeof(float);
+	uintptr_t dst_ptr, src_ptr = (uintptr_t) src;
+	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
+	ptrdiff_t buf_step = iio_buffer_step(buf);
+	uint64_t tmp[CONVERT_TILE_SIZE / sizeof(uint64_t)];
+	float scale;
+	size_t i, tile, nb;
+
+	if (!plan->from_float || !length || length > CONVERT_TILE_SIZE)
+		return -ENOSYS;
+
+	scale = (float) iio_channel_get_scale(chn);
+	dst_ptr = (uintptr_t) iio_buffer_first(buf, chn);
+	if (dst_ptr >= buf_end)
+		return 0;
+
+	nb = (buf_end - dst_ptr + buf_step - 1) / buf_step;
+	if (nb > len / in_len)
+		nb = len / in_len;
+
+	for (i = 0; i < nb; i += tile) {
+		tile = nb - i;
+		if (tile > CONVERT_TILE_SIZE / length)
+			tile = CONVERT_TILE_SIZE / length;
+
+		if (buf_step == (ptrdiff_t) length) {
+			plan->from_float(plan, (void *) dst_ptr,
+					(const float *) src_ptr,
+					tile * chn->format.repeat, scale);
+		} else {
+			plan->from_float(plan, tmp, (const float *) src_ptr,
+					tile * chn->format.repeat, scale);
+			iio_copy_strided(dst_ptr, buf_step, (uintptr_t) tmp,
+					length, length, tile);
+		}
+
+		dst_ptr += tile * buf_step;
+		src_ptr += tile * in_len;
+	}
+
+	return src_ptr - (uintptr_t) src;
+}
+
+int iio_buffer_compute_stats_partial(const struct iio_buffer *buf,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats, size_t samples_count)
+{
+	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
+	ptrdiff_t buf_step = iio_buffer_step(buf);
+	uint64_t tmp[CONVERT_TILE_SIZE / sizeof(uint64_t)];
+	unsigned int j, length, max_length = 1;
+	size_t i, tile, nb = 0, max_tile;
+
+	for (j = 0; j < nb_channels; j++) {
+		const struct iio_channel *chn = chns[j];
+
+		length = chn->format.length / 8 * chn->format.repeat;
+		if (chn->dev != buf->dev)
+			return -EINVAL;
+		if (!chn->convert.stats || length > CONVERT_TILE_SIZE)
+			return -ENOSYS;
+		if (length > max_length)
+			max_length = length;
+
+		memset(&stats[j], 0, sizeof(stats[j]));
+		stats[j].min = INT64_MAX;
+		stats[j].max = INT64_MIN;
+	}
+
+	if (buf_step)
+		nb = buf->data_length / buf_step;
+	if (nb > samples_count)
+		nb = samples_count;
+	max_tile = CONVERT_TILE_SIZE / max_length;
+
+	/* Go through the buffer once: each tile of samples is summarized for
+	 * all the channels while it is in the cache */
+	for (i = 0; i < nb; i += tile) {
+		tile = nb - i;
+		if (tile > max_tile)
+			tile = max_tile;
+
+		for (j = 0; j < nb_channels; j++) {
+			const struct iio_channel *chn = chns[j];
+			const struct iio_convert_plan *plan = &chn->convert;
+			size_t nb_values = tile * chn->format.repeat;
+			uintptr_t src = (uintptr_t) iio_buffer_first(buf, chn);
+
+			if (src >= buf_end)
+				continue;
+
+			src += i * buf_step;
+			length = chn->format.length / 8 * chn->format.repeat;
+
+			if (buf_step == (ptrdiff_t) length) {
+				plan->convert(plan, tmp,
+						(const void *) src, nb_values);
+			} else {
+				iio_copy_strided((uintptr_t) tmp, length,
+						src, buf_step, length, tile);
+				plan->convert(plan, tmp, tmp, nb_values);
+			}
+
+			plan->stats(plan, &stats[j], tmp, nb_values);
+		}
+	}
+
+	for (j = 0; j < nb_channels; j++) {
+		if (!stats[j].count) {
+			stats[j].min = 0;
+			stats[j].max = 0;
+		}
+	}
+
+	return 0;
+}
+
+int iio_buffer_compute_stats(const struct iio_buffer *buf,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats)
+{
+	ptrdiff_t buf_step = iio_buffer_step(buf);
+
+	return iio_buffer_compute_stats_partial(buf, chns, nb_channels, stats,
+			buf_step ? buf->data_length / buf_step : 0);
+}
+
+static bool same_conversion(const struct iio_convert_plan *a,
+		const struct iio_convert_plan *b)
+{
+	return a->convert == b->convert && a->shift == b->shift &&
+		a->bits == b->bits && a->swap == b->swap &&
+		a->sign_extend == b->sign_extend &&
+		a->mask_convert == b->mask_convert &&
+		a->is_signed == b->is_signed;
+}
+
+static ssize_t read_iq(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn, struct iio_buffer *buf,
+		void *dst, size_t len, bool is_float)
+{
+	const struct iio_convert_plan *i_plan = &i_chn->convert,
+	      *q_plan = &q_chn->convert;
+	unsigned int width = i_chn->format.length / 8;
+	size_t out_len = 2 * (is_float ? sizeof(float) : sizeof(int16_t));
+	ptrdiff_t step = (ptrdiff_t) buf->sample_size, q_offset;
+	uint64_t raw[2 * IQ_TILE], tmp[IQ_TILE];
+	uintptr_t src_ptr, dst_ptr = (uintptr_t) dst;
+	float i_scale = 1.0f, q_scale = 1.0f;
+	size_t i, j, tile, nb;
+	bool fused;
+
+	if (i_chn->dev != buf->dev || q_chn->dev != buf->dev ||
+			!iio_channel_is_enabled(i_chn) ||
+			!iio_channel_is_enabled(q_chn) ||
+			i_chn->format.repeat != 1 || q_chn->format.repeat != 1 ||
+			q_chn->format.length != i_chn->format.length || !step)
+		return -EINVAL;
+
+	if (!i_plan->to_float || !q_plan->to_float)
+		return -ENOSYS;
+
+	/* Complex int16 output does not narrow or widen the samples */
+	if (!is_float && width != sizeof(int16_t))
+		return -EINVAL;
+
+	if (is_float) {
+		i_scale = (float) iio_channel_get_scale(i_chn);
+		q_scale = (float) iio_channel_get_scale(q_chn);
+	}
+
+	src_ptr = (uintptr_t) buf->buffer + buf->offsets[i_chn->number];
+	q_offset = (ptrdiff_t) buf->offsets[q_chn->number] -
+		(ptrdiff_t) buf->offsets[i_chn->number];
+
+	nb = buf->data_length / step;
+	if (nb > len / out_len)
+		nb = len / out_len;
+
+	/* When Q directly follows I and both use the same format, the raw
+	 * I/Q samples are already interleaved: convert them as a whole. */
+	fused = q_offset == (ptrdiff_t) width &&
+		same_conversion(i_plan, q_plan) && i_scale == q_scale;
+
+	for (i = 0; i < nb; i += tile) {
+		tile = nb - i;
+		if (tile > IQ_TILE)
+			tile = IQ_TILE;
+
+		if (fused) {
+			const void *src = raw;
+
+			if (step == (ptrdiff_t) (2 * width))
+				src = (const void *) src_ptr;
+			else
+				iio_copy_strided((uintptr_t) raw, 2 * width,
+						src_ptr, step, 2 * width, tile);
+
+			if (is_float)
+				i_plan->to_float(i_plan, (float *) dst_ptr,
+						src, 2 * tile, i_scale);
+			else
+				i_plan->convert(i_plan, (void *) dst_ptr,
+						src, 2 * tile);
+		} else {
+			iio_copy_strided((uintptr_t) raw, width,
+					src_ptr, step, width, tile);
+			iio_copy_strided((uintptr_t) (raw + IQ_TILE), width,
+					src_ptr + q_offset, step, width, tile);
+
+			if (is_float) {
+				float *out = (float *) dst_ptr,
+				      *i_out = (float *) tmp,
+				      *q_out = (float *) tmp + tile;
+
+				i_plan->to_float(i_plan, i_out, raw,
+						tile, i_scale);
+				q_plan->to_float(q_plan, q_out, raw + IQ_TILE,
+						tile, q_scale);
+				for (j = 0; j < tile; j++) {
+					out[2 * j] = i_out[j];
+					out[2 * j + 1] = q_out[j];
+				}
+			} else {
+				int16_t *out = (int16_t *) dst_ptr,
+					*i_out = (int16_t *) raw,
+					*q_out = (int16_t *) (raw + IQ_TILE);
+
+				i_plan->convert(i_plan, i_out, i_out, tile);
+				q_plan->convert(q_plan, q_out, q_out, tile);
+				for (j = 0; j < tile; j++) {
+					out[2 * j] = i_out[j];
+					out[2 * j + 1] = q_out[j];
+				}
+			}
+		}
+
+		src_ptr += tile * step;
+		dst_ptr += tile * out_len;
+	}
+
+	return dst_ptr - (uintptr_t) dst;
+}
+
+ssize_t iio_channel_read_iq_float(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn, struct iio_buffer *buf,
+		float *dst, size_t len)
+{
+	return read_iq(i_chn, q_chn, buf, dst, len, true);
+}
+
+ssize_t iio_channel_read_iq_int16(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn, struct iio_buffer *buf,
+		int16_t *dst, size_t len)
+{
+	return read_iq(i_chn, q_chn, buf, dst, len, false);
+}
+
 int iio_channel_attr_read_longlong(const struct iio_channel *chn,
 		const char *attr, long long *val)
 {
@@ -232,8 +232,16 @@ int iio_context_init(struct iio_context *ctx)
 {
 	unsigned int i;
 
-	for (i = 0; i < ctx->nb_devices; i++)
-		reorder_channels(ctx->devices[i]);
+	for (i = 0; i < ctx->nb_devices; i++) {
+		struct iio_device *dev = ctx->devices[i];
+		unsigned int j;
+
+		reorder_channels(dev);
+
+		for (j = 0; j < dev->nb_channels; j++)
+			iio_convert_plan_init(&dev->channels[j]->convert,
+					&dev->channels[j]->format);
+	}
 
 	if (!ctx->xml) {
 		ctx->xml = iio_context_create_xml(ctx);
@@ -244,6 +252,34 @@ int iio_context_init(struct iio_context *ctx)
 	return 0;
 }
 
+/* Contexts created from the XML of an older IIOD do not carry the scale of
+ * the scan elements. The backends call this once their low-level functions
+ * are set, so that the scale is read from the 'scale' attribute when the
+ * context is created, and never from the paths converting samples. */
+void iio_context_init_scales(struct iio_context *ctx)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < ctx->nb_devices; i++) {
+		struct iio_device *dev = ctx->devices[i];
+
+		for (j = 0; j < dev->nb_channels; j++) {
+			struct iio_channel *chn = dev->channels[j];
+			double scale;
+
+			if (!chn->is_scan_element || chn->format.with_scale ||
+					!iio_channel_find_attr(chn, "scale"))
+				continue;
+
+			if (!iio_channel_attr_read_double(chn,
+						"scale", &scale)) {
+				chn->format.scale = scale;
+				chn->format.with_scale = true;
+			}
+		}
+	}
+}
+
 int iio_context_get_version(const struct iio_context *ctx,
 		unsigned int *major, unsigned int *minor, char git_tag[8])
 {
@@ -275,8 +311,8 @@ struct iio_context * iio_context_clone(const struct iio_context *ctx)
 struct iio_context * iio_create_context_from_uri(const char *uri)
 {
 #ifdef WITH_LOCAL_BACKEND
-	if (strcmp(uri, "local:") == 0) /* No address part */
-		return iio_create_local_context();
+	if (strncmp(uri, "local:", sizeof("local:") - 1) == 0)
+		return local_create_context_from_uri(uri);
 #endif
 
 #ifdef WITH_XML_BACKEND
@@ -0,0 +1,1462 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include "debug.h"
+#include "iio-private.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_KERNELS 1
+#include <immintrin.h>
+#define __target(x) __attribute__((target(x)))
+#elif defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define HAS_NEON_KERNELS 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * The bulk kernels below convert a contiguous array of elements. They all
+ * implement exactly what iio_channel_convert() and
+ * iio_channel_convert_inverse() do for one element:
+ * - convert: byte-swap, shift right, then sign-extend or mask to 'bits';
+ * - convert_inverse: mask to 'bits', shift left, then byte-swap.
+ * dst and src may be the same array.
+ */
+
+static inline uint16_t bswap16(uint16_t v)
+{
+	return (uint16_t) ((v >> 8) | (v << 8));
+}
+
+static inline uint32_t bswap32(uint32_t v)
+{
+#ifdef __GNUC__
+	return __builtin_bswap32(v);
+#else
+	return ((v & 0xff) << 24) | ((v & 0xff00) << 8) |
+		((v >> 8) & 0xff00) | ((v >> 24) & 0xff);
+#endif
+}
+
+static inline uint64_t bswap64(uint64_t v)
+{
+#ifdef __GNUC__
+	return __builtin_bswap64(v);
+#else
+	return ((uint64_t) bswap32((uint32_t) v) << 32) |
+		bswap32((uint32_t) (v >> 32));
+#endif
+}
+
+static inline uint8_t bswap8(uint8_t v)
+{
+	return v;
+}
+
+/* Quantize a sample to the integer range of the channel, rounding to the
+ * nearest integer (ties away from zero). NaN gives the lower bound. */
+static inline uint64_t quantize(const struct iio_convert_plan *plan, float v)
+{
+	v += v < 0.0f ? -0.5f : 0.5f;
+	if (!(v > plan->fmin))
+		return plan->qmin;
+	if (v >= plan->fmax)
+		return plan->qmax;
+	if (plan->is_signed)
+		return (uint64_t) (int64_t) v;
+	else
+		return (uint64_t) v;
+}
+
+/* Saturate an integer sample to the range of the channel */
+static inline uint64_t saturate(const struct iio_convert_plan *plan,
+		int64_t v)
+{
+	if (plan->is_signed) {
+		if (v < (int64_t) plan->qmin)
+			return plan->qmin;
+		if (v > (int64_t) plan->qmax)
+			return plan->qmax;
+	} else {
+		if (v < 0)
+			return 0;
+		if ((uint64_t) v > plan->qmax)
+			return plan->qmax;
+	}
+	return (uint64_t) v;
+}
+
+#define DEFINE_SCALAR_KERNELS(width, type, stype)			\
+static inline type convert_one_##width(					\
+		const struct iio_convert_plan *plan, type v)		\
+{									\
+	unsigned int ext = width - plan->bits;				\
+									\
+	if (plan->swap)							\
+		v = bswap##width(v);					\
+	v = (type) (v >> plan->shift);					\
+	if (plan->sign_extend)						\
+		v = (type) ((stype) (type) (v << ext) >> ext);		\
+	else if (plan->mask_convert)					\
+		v &= (type) plan->mask;					\
+	return v;							\
+}									\
+									\
+static inline type convert_inverse_one_##width(				\
+		const struct iio_convert_plan *plan, type v)		\
+{									\
+	if (plan->mask_bits)						\
+		v &= (type) plan->mask;					\
+	v = (type) (v << plan->shift);					\
+	if (plan->swap)							\
+		v = bswap##width(v);					\
+	return v;							\
+}									\
+									\
+static void convert_scalar_##width(const struct iio_convert_plan *plan,	\
+		void *dst, const void *src, size_t nb)			\
+{									\
+	const uint8_t *s = src;						\
+	uint8_t *d = dst;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v;							\
+									\
+		memcpy(&v, s + i * sizeof(v), sizeof(v));		\
+		v = convert_one_##width(plan, v);			\
+		memcpy(d + i * sizeof(v), &v, sizeof(v));		\
+	}								\
+}									\
+									\
+static void convert_inverse_scalar_##width(				\
+		const struct iio_convert_plan *plan,			\
+		void *dst, const void *src, size_t nb)			\
+{									\
+	const uint8_t *s = src;						\
+	uint8_t *d = dst;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v;							\
+									\
+		memcpy(&v, s + i * sizeof(v), sizeof(v));		\
+		v = convert_inverse_one_##width(plan, v);		\
+		memcpy(d + i * sizeof(v), &v, sizeof(v));		\
+	}								\
+}									\
+									\
+static void to_float_scalar_##width(const struct iio_convert_plan *plan,	\
+		float *dst, const void *src, size_t nb, float scale)	\
+{									\
+	const uint8_t *s = src;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v;							\
+									\
+		memcpy(&v, s + i * sizeof(v), sizeof(v));		\
+		v = convert_one_##width(plan, v);			\
+		if (plan->is_signed)					\
+			dst[i] = (float) (stype) v * scale;		\
+		else							\
+			dst[i] = (float) v * scale;			\
+	}								\
+}									\
+									\
+static void to_double_scalar_##width(const struct iio_convert_plan *plan,\
+		double *dst, const void *src, size_t nb, double scale)	\
+{									\
+	const uint8_t *s = src;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v;							\
+									\
+		memcpy(&v, s + i * sizeof(v), sizeof(v));		\
+		v = convert_one_##width(plan, v);			\
+		if (plan->is_signed)					\
+			dst[i] = (double) (stype) v * scale;		\
+		else							\
+			dst[i] = (double) v * scale;			\
+	}								\
+}									\
+									\
+static void from_float_scalar_##width(					\
+		const struct iio_convert_plan *plan,			\
+		void *dst, const float *src, size_t nb, float scale)	\
+{									\
+	uint8_t *d = dst;						\
+	float inv = 1.0f / scale;					\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v = (type) quantize(plan, src[i] * inv);		\
+									\
+		v = convert_inverse_one_##width(plan, v);		\
+		memcpy(d + i * sizeof(v), &v, sizeof(v));		\
+	}								\
+}									\
+									\
+static void from_int16_scalar_##width(					\
+		const struct iio_convert_plan *plan,			\
+		void *dst, const int16_t *src, size_t nb)		\
+{									\
+	uint8_t *d = dst;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v = (type) saturate(plan, src[i]);			\
+									\
+		v = convert_inverse_one_##width(plan, v);		\
+		memcpy(d + i * sizeof(v), &v, sizeof(v));		\
+	}								\
+}									\
+									\
+static void quantize_scalar_##width(const struct iio_convert_plan *plan,	\
+		void *dst, const float *src, size_t nb)			\
+{									\
+	uint8_t *d = dst;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		type v = (type) quantize(plan, src[i]);			\
+									\
+		memcpy(d + i * sizeof(v), &v, sizeof(v));		\
+	}								\
+}									\
+									\
+static void stats_scalar_##width(const struct iio_convert_plan *plan,	\
+		struct iio_channel_stats *stats, const void *src, size_t nb) \
+{									\
+	const uint8_t *s = src;						\
+	size_t i;							\
+									\
+	for (i = 0; i < nb; i++) {					\
+		int64_t x;						\
+		type v;							\
+									\
+		memcpy(&v, s + i * sizeof(v), sizeof(v));		\
+		x = plan->is_signed ? (int64_t) (stype) v : (int64_t) v;	\
+		if (x < stats->min)					\
+			stats->min = x;					\
+		if (x > stats->max)					\
+			stats->max = x;					\
+		stats->sum += x;					\
+		stats->sum_squares += (double) x * (double) x;		\
+		if ((uint64_t) x == plan->qmin ||			\
+				(uint64_t) x == plan->qmax)		\
+			stats->clipped++;				\
+	}								\
+									\
+	stats->count += nb;						\
+}
+
+DEFINE_SCALAR_KERNELS(8, uint8_t, int8_t)
+DEFINE_SCALAR_KERNELS(16, uint16_t, int16_t)
+DEFINE_SCALAR_KERNELS(32, uint32_t, int32_t)
+DEFINE_SCALAR_KERNELS(64, uint64_t, int64_t)
+
+#ifdef HAS_X86_KERNELS
+
+#ifdef __i386__
+#define __sse2 __target("sse2")
+#else
+#define __sse2 /* SSE2 is part of the x86_64 baseline */
+#endif
+
+static __sse2 __m128i sse2_bswap16(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static __sse2 __m128i sse2_bswap32(__m128i v)
+{
+	/* SSE2 has no byte shuffle: swap the 16-bit halves, then the bytes */
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	return sse2_bswap16(v);
+}
+
+static __sse2 inline __m128i sse2_convert_16(
+		const struct iio_convert_plan *plan, __m128i v,
+		__m128i shift, __m128i ext, __m128i mask)
+{
+	if (plan->swap)
+		v = sse2_bswap16(v);
+	v = _mm_srl_epi16(v, shift);
+	if (plan->sign_extend)
+		v = _mm_sra_epi16(_mm_sll_epi16(v, ext), ext);
+	else if (plan->mask_convert)
+		v = _mm_and_si128(v, mask);
+	return v;
+}
+
+static __sse2 inline __m128i sse2_convert_32(
+		const struct iio_convert_plan *plan, __m128i v,
+		__m128i shift, __m128i ext, __m128i mask)
+{
+	if (plan->swap)
+		v = sse2_bswap32(v);
+	v = _mm_srl_epi32(v, shift);
+	if (plan->sign_extend)
+		v = _mm_sra_epi32(_mm_sll_epi32(v, ext), ext);
+	else if (plan->mask_convert)
+		v = _mm_and_si128(v, mask);
+	return v;
+}
+
+static __sse2 inline __m128i sse2_convert_inverse_16(
+		const struct iio_convert_plan *plan, __m128i v,
+		__m128i shift, __m128i mask)
+{
+	if (plan->mask_bits)
+		v = _mm_and_si128(v, mask);
+	v = _mm_sll_epi16(v, shift);
+	if (plan->swap)
+		v = sse2_bswap16(v);
+	return v;
+}
+
+/* Range of the int16_t samples that a 16-bit channel can represent */
+static inline int16_t clamp16_lo(const struct iio_convert_plan *plan)
+{
+	return plan->is_signed ? (int16_t) (int64_t) plan->qmin : 0;
+}
+
+static inline int16_t clamp16_hi(const struct iio_convert_plan *plan)
+{
+	return plan->qmax > INT16_MAX ? INT16_MAX : (int16_t) plan->qmax;
+}
+
+static __sse2 void convert_sse2_16(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (16 - plan->bits)),
+		mask = _mm_set1_epi16((short) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + i * 2));
+
+		v = sse2_convert_16(plan, v, shift, ext, mask);
+		_mm_storeu_si128((__m128i *) (d + i * 2), v);
+	}
+
+	convert_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+static __sse2 void convert_inverse_sse2_16(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		mask = _mm_set1_epi16((short) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + i * 2));
+
+		v = sse2_convert_inverse_16(plan, v, shift, mask);
+		_mm_storeu_si128((__m128i *) (d + i * 2), v);
+	}
+
+	convert_inverse_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+/* Round to nearest (ties away from zero) and saturate, as quantize() does,
+ * for a channel of at most 16 bits: 'lo' and 'hi' are exact in a float. */
+static __sse2 inline __m128i sse2_quantize(__m128 v, __m128 inv,
+		__m128 lo, __m128 hi)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f), half = _mm_set1_ps(0.5f);
+
+	v = _mm_mul_ps(v, inv);
+	v = _mm_add_ps(v, _mm_or_ps(half, _mm_and_ps(v, sign)));
+	v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+	return _mm_cvttps_epi32(v);
+}
+
+/* Keep the low 16 bits of each 32-bit element, and pack them */
+static __sse2 inline __m128i sse2_pack_low16(__m128i a, __m128i b)
+{
+	a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+	b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static __sse2 void from_float_sse2_16(const struct iio_convert_plan *plan,
+		void *dst, const float *src, size_t nb, float scale)
+{
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		mask = _mm_set1_epi16((short) plan->mask);
+	__m128 inv = _mm_set1_ps(1.0f / scale),
+	       lo = _mm_set1_ps(plan->fmin), hi = _mm_set1_ps(plan->fmax);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m128i a = sse2_quantize(_mm_loadu_ps(src + i), inv, lo, hi),
+			b = sse2_quantize(_mm_loadu_ps(src + i + 4),
+					inv, lo, hi),
+			v = sse2_pack_low16(a, b);
+
+		v = sse2_convert_inverse_16(plan, v, shift, mask);
+		_mm_storeu_si128((__m128i *) (d + i * 2), v);
+	}
+
+	from_float_scalar_16(plan, d + i * 2, src + i, nb - i, scale);
+}
+
+static __sse2 void from_int16_sse2_16(const struct iio_convert_plan *plan,
+		void *dst, const int16_t *src, size_t nb)
+{
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		mask = _mm_set1_epi16((short) plan->mask),
+		lo = _mm_set1_epi16((short) clamp16_lo(plan)),
+		hi = _mm_set1_epi16((short) clamp16_hi(plan));
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+
+		v = _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+		v = sse2_convert_inverse_16(plan, v, shift, mask);
+		_mm_storeu_si128((__m128i *) (d + i * 2), v);
+	}
+
+	from_int16_scalar_16(plan, d + i * 2, src + i, nb - i);
+}
+
+static __sse2 void to_float_sse2_16(const struct iio_convert_plan *plan,
+		float *dst, const void *src, size_t nb, float scale)
+{
+	const uint8_t *s = src;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (16 - plan->bits)),
+		mask = _mm_set1_epi16((short) plan->mask),
+		zero = _mm_setzero_si128();
+	__m128 mul = _mm_set1_ps(scale);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m128i lo, hi, v = _mm_loadu_si128(
+				(const __m128i *) (s + i * 2));
+
+		v = sse2_convert_16(plan, v, shift, ext, mask);
+		if (plan->is_signed) {
+			lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		} else {
+			lo = _mm_unpacklo_epi16(v, zero);
+			hi = _mm_unpackhi_epi16(v, zero);
+		}
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), mul));
+		_mm_storeu_ps(dst + i + 4,
+				_mm_mul_ps(_mm_cvtepi32_ps(hi), mul));
+	}
+
+	to_float_scalar_16(plan, dst + i, s + i * 2, nb - i, scale);
+}
+
+/* Statistics of signed 16-bit samples in the CPU format. The 32-bit sums
+ * and 16-bit clip counters are flushed before they can overflow. */
+#define STATS_16_CHUNK (16384 * 8)
+
+static void stats_merge_16(struct iio_channel_stats *stats,
+		const int16_t *mins, const int16_t *maxs, size_t nb_lanes)
+{
+	size_t i;
+
+	for (i = 0; i < nb_lanes; i++) {
+		if (mins[i] < stats->min)
+			stats->min = mins[i];
+		if (maxs[i] > stats->max)
+			stats->max = maxs[i];
+	}
+}
+
+static __sse2 void stats_sse2_16(const struct iio_convert_plan *plan,
+		struct iio_channel_stats *stats, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	__m128i lo = _mm_set1_epi16(clamp16_lo(plan)),
+		hi = _mm_set1_epi16(clamp16_hi(plan)),
+		ones = _mm_set1_epi16(1), zero = _mm_setzero_si128(),
+		vmin = _mm_set1_epi16(INT16_MAX),
+		vmax = _mm_set1_epi16(INT16_MIN), sq = zero;
+	int16_t mins[8], maxs[8];
+	uint16_t clips[8];
+	uint64_t sqs[2];
+	int32_t sums[4];
+	size_t i = 0, j, end;
+
+	while (i + 8 <= nb) {
+		__m128i sum = zero, clip = zero;
+
+		end = nb - i > STATS_16_CHUNK ? i + STATS_16_CHUNK : nb;
+
+		for (; i + 8 <= end; i += 8) {
+			__m128i v = _mm_loadu_si128(
+					(const __m128i *) (s + i * 2)), v2;
+
+			vmin = _mm_min_epi16(vmin, v);
+			vmax = _mm_max_epi16(vmax, v);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(v, ones));
+			clip = _mm_sub_epi16(clip, _mm_or_si128(
+						_mm_cmpeq_epi16(v, lo),
+						_mm_cmpeq_epi16(v, hi)));
+
+			/* A pair of squares fits in 32 bits, unsigned */
+			v2 = _mm_madd_epi16(v, v);
+			sq = _mm_add_epi64(sq, _mm_unpacklo_epi32(v2, zero));
+			sq = _mm_add_epi64(sq, _mm_unpackhi_epi32(v2, zero));
+		}
+
+		_mm_storeu_si128((__m128i *) sums, sum);
+		_mm_storeu_si128((__m128i *) clips, clip);
+		for (j = 0; j < 4; j++)
+			stats->sum += sums[j];
+		for (j = 0; j < 8; j++)
+			stats->clipped += clips[j];
+	}
+
+	_mm_storeu_si128((__m128i *) mins, vmin);
+	_mm_storeu_si128((__m128i *) maxs, vmax);
+	_mm_storeu_si128((__m128i *) sqs, sq);
+	stats_merge_16(stats, mins, maxs, i ? 8 : 0);
+	stats->sum_squares += (double) sqs[0] + (double) sqs[1];
+	stats->count += i;
+
+	stats_scalar_16(plan, stats, s + i * 2, nb - i);
+}
+
+static __sse2 void convert_sse2_32(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (32 - plan->bits)),
+		mask = _mm_set1_epi32((int) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + i * 4));
+
+		v = sse2_convert_32(plan, v, shift, ext, mask);
+		_mm_storeu_si128((__m128i *) (d + i * 4), v);
+	}
+
+	convert_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+static __sse2 void convert_inverse_sse2_32(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		mask = _mm_set1_epi32((int) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + i * 4));
+
+		if (plan->mask_bits)
+			v = _mm_and_si128(v, mask);
+		v = _mm_sll_epi32(v, shift);
+		if (plan->swap)
+			v = sse2_bswap32(v);
+		_mm_storeu_si128((__m128i *) (d + i * 4), v);
+	}
+
+	convert_inverse_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+/* Only used when the converted values fit in an int32_t */
+static __sse2 void to_float_sse2_32(const struct iio_convert_plan *plan,
+		float *dst, const void *src, size_t nb, float scale)
+{
+	const uint8_t *s = src;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (32 - plan->bits)),
+		mask = _mm_set1_epi32((int) plan->mask);
+	__m128 mul = _mm_set1_ps(scale);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + i * 4));
+
+		v = sse2_convert_32(plan, v, shift, ext, mask);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), mul));
+	}
+
+	to_float_scalar_32(plan, dst + i, s + i * 4, nb - i, scale);
+}
+
+static __target("avx2") inline __m256i avx2_bswap(__m256i v,
+		unsigned int width)
+{
+	const __m256i swap16 = _mm256_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	const __m256i swap32 = _mm256_setr_epi8(
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+			3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	return _mm256_shuffle_epi8(v, width == 16 ? swap16 : swap32);
+}
+
+static __target("avx2") inline __m256i avx2_convert_16(
+		const struct iio_convert_plan *plan, __m256i v,
+		__m128i shift, __m128i ext, __m256i mask)
+{
+	if (plan->swap)
+		v = avx2_bswap(v, 16);
+	v = _mm256_srl_epi16(v, shift);
+	if (plan->sign_extend)
+		v = _mm256_sra_epi16(_mm256_sll_epi16(v, ext), ext);
+	else if (plan->mask_convert)
+		v = _mm256_and_si256(v, mask);
+	return v;
+}
+
+static __target("avx2") inline __m256i avx2_convert_32(
+		const struct iio_convert_plan *plan, __m256i v,
+		__m128i shift, __m128i ext, __m256i mask)
+{
+	if (plan->swap)
+		v = avx2_bswap(v, 32);
+	v = _mm256_srl_epi32(v, shift);
+	if (plan->sign_extend)
+		v = _mm256_sra_epi32(_mm256_sll_epi32(v, ext), ext);
+	else if (plan->mask_convert)
+		v = _mm256_and_si256(v, mask);
+	return v;
+}
+
+static __target("avx2") inline __m256i avx2_convert_inverse_16(
+		const struct iio_convert_plan *plan, __m256i v,
+		__m128i shift, __m256i mask)
+{
+	if (plan->mask_bits)
+		v = _mm256_and_si256(v, mask);
+	v = _mm256_sll_epi16(v, shift);
+	if (plan->swap)
+		v = avx2_bswap(v, 16);
+	return v;
+}
+
+static __target("avx2") void convert_avx2_16(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (16 - plan->bits));
+	__m256i mask = _mm256_set1_epi16((short) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (s + i * 2));
+
+		v = avx2_convert_16(plan, v, shift, ext, mask);
+		_mm256_storeu_si256((__m256i *) (d + i * 2), v);
+	}
+
+	convert_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+static __target("avx2") void convert_inverse_avx2_16(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift);
+	__m256i mask = _mm256_set1_epi16((short) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (s + i * 2));
+
+		v = avx2_convert_inverse_16(plan, v, shift, mask);
+		_mm256_storeu_si256((__m256i *) (d + i * 2), v);
+	}
+
+	convert_inverse_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+static __target("avx2") inline __m256i avx2_quantize(__m256 v, __m256 inv,
+		__m256 lo, __m256 hi)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f),
+	      half = _mm256_set1_ps(0.5f);
+
+	v = _mm256_mul_ps(v, inv);
+	v = _mm256_add_ps(v, _mm256_or_ps(half, _mm256_and_ps(v, sign)));
+	v = _mm256_min_ps(_mm256_max_ps(v, lo), hi);
+	return _mm256_cvttps_epi32(v);
+}
+
+static __target("avx2") void from_float_avx2_16(
+		const struct iio_convert_plan *plan,
+		void *dst, const float *src, size_t nb, float scale)
+{
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift);
+	__m256i mask = _mm256_set1_epi16((short) plan->mask),
+		low16 = _mm256_set1_epi32(0xffff);
+	__m256 inv = _mm256_set1_ps(1.0f / scale),
+	       lo = _mm256_set1_ps(plan->fmin),
+	       hi = _mm256_set1_ps(plan->fmax);
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		__m256i a = avx2_quantize(_mm256_loadu_ps(src + i),
+				inv, lo, hi),
+			b = avx2_quantize(_mm256_loadu_ps(src + i + 8),
+					inv, lo, hi), v;
+
+		/* packus works per 128-bit lane: restore the order after */
+		v = _mm256_packus_epi32(_mm256_and_si256(a, low16),
+				_mm256_and_si256(b, low16));
+		v = _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0));
+		v = avx2_convert_inverse_16(plan, v, shift, mask);
+		_mm256_storeu_si256((__m256i *) (d + i * 2), v);
+	}
+
+	from_float_scalar_16(plan, d + i * 2, src + i, nb - i, scale);
+}
+
+static __target("avx2") void from_int16_avx2_16(
+		const struct iio_convert_plan *plan,
+		void *dst, const int16_t *src, size_t nb)
+{
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift);
+	__m256i mask = _mm256_set1_epi16((short) plan->mask),
+		lo = _mm256_set1_epi16((short) clamp16_lo(plan)),
+		hi = _mm256_set1_epi16((short) clamp16_hi(plan));
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + i));
+
+		v = _mm256_min_epi16(_mm256_max_epi16(v, lo), hi);
+		v = avx2_convert_inverse_16(plan, v, shift, mask);
+		_mm256_storeu_si256((__m256i *) (d + i * 2), v);
+	}
+
+	from_int16_scalar_16(plan, d + i * 2, src + i, nb - i);
+}
+
+static __target("avx2") void to_float_avx2_16(
+		const struct iio_convert_plan *plan,
+		float *dst, const void *src, size_t nb, float scale)
+{
+	const uint8_t *s = src;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (16 - plan->bits));
+	__m256i mask = _mm256_set1_epi16((short) plan->mask);
+	__m256 mul = _mm256_set1_ps(scale);
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		__m256i lo, hi, v = _mm256_loadu_si256(
+				(const __m256i *) (s + i * 2));
+
+		v = avx2_convert_16(plan, v, shift, ext, mask);
+		if (plan->is_signed) {
+			lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+			hi = _mm256_cvtepi16_epi32(
+					_mm256_extracti128_si256(v, 1));
+		} else {
+			lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+			hi = _mm256_cvtepu16_epi32(
+					_mm256_extracti128_si256(v, 1));
+		}
+		_mm256_storeu_ps(dst + i,
+				_mm256_mul_ps(_mm256_cvtepi32_ps(lo), mul));
+		_mm256_storeu_ps(dst + i + 8,
+				_mm256_mul_ps(_mm256_cvtepi32_ps(hi), mul));
+	}
+
+	to_float_scalar_16(plan, dst + i, s + i * 2, nb - i, scale);
+}
+
+static __target("avx2") void stats_avx2_16(
+		const struct iio_convert_plan *plan,
+		struct iio_channel_stats *stats, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	__m256i lo = _mm256_set1_epi16(clamp16_lo(plan)),
+		hi = _mm256_set1_epi16(clamp16_hi(plan)),
+		ones = _mm256_set1_epi16(1), zero = _mm256_setzero_si256(),
+		vmin = _mm256_set1_epi16(INT16_MAX),
+		vmax = _mm256_set1_epi16(INT16_MIN), sq = zero;
+	int16_t mins[16], maxs[16];
+	uint16_t clips[16];
+	uint64_t sqs[4];
+	int32_t sums[8];
+	size_t i = 0, j, end;
+
+	while (i + 16 <= nb) {
+		__m256i sum = zero, clip = zero;
+
+		end = nb - i > STATS_16_CHUNK ? i + STATS_16_CHUNK : nb;
+
+		for (; i + 16 <= end; i += 16) {
+			__m256i v = _mm256_loadu_si256(
+					(const __m256i *) (s + i * 2)), v2;
+
+			vmin = _mm256_min_epi16(vmin, v);
+			vmax = _mm256_max_epi16(vmax, v);
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, ones));
+			clip = _mm256_sub_epi16(clip, _mm256_or_si256(
+						_mm256_cmpeq_epi16(v, lo),
+						_mm256_cmpeq_epi16(v, hi)));
+
+			v2 = _mm256_madd_epi16(v, v);
+			sq = _mm256_add_epi64(sq,
+					_mm256_unpacklo_epi32(v2, zero));
+			sq = _mm256_add_epi64(sq,
+					_mm256_unpackhi_epi32(v2, zero));
+		}
+
+		_mm256_storeu_si256((__m256i *) sums, sum);
+		_mm256_storeu_si256((__m256i *) clips, clip);
+		for (j = 0; j < 8; j++)
+			stats->sum += sums[j];
+		for (j = 0; j < 16; j++)
+			stats->clipped += clips[j];
+	}
+
+	_mm256_storeu_si256((__m256i *) mins, vmin);
+	_mm256_storeu_si256((__m256i *) maxs, vmax);
+	_mm256_storeu_si256((__m256i *) sqs, sq);
+	stats_merge_16(stats, mins, maxs, i ? 16 : 0);
+	stats->sum_squares += (double) sqs[0] + (double) sqs[1] +
+		(double) sqs[2] + (double) sqs[3];
+	stats->count += i;
+
+	stats_scalar_16(plan, stats, s + i * 2, nb - i);
+}
+
+static __target("avx2") void convert_avx2_32(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (32 - plan->bits));
+	__m256i mask = _mm256_set1_epi32((int) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (s + i * 4));
+
+		v = avx2_convert_32(plan, v, shift, ext, mask);
+		_mm256_storeu_si256((__m256i *) (d + i * 4), v);
+	}
+
+	convert_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+static __target("avx2") void convert_inverse_avx2_32(
+		const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift);
+	__m256i mask = _mm256_set1_epi32((int) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (s + i * 4));
+
+		if (plan->mask_bits)
+			v = _mm256_and_si256(v, mask);
+		v = _mm256_sll_epi32(v, shift);
+		if (plan->swap)
+			v = avx2_bswap(v, 32);
+		_mm256_storeu_si256((__m256i *) (d + i * 4), v);
+	}
+
+	convert_inverse_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+/* Only used when the converted values fit in an int32_t */
+static __target("avx2") void to_float_avx2_32(
+		const struct iio_convert_plan *plan,
+		float *dst, const void *src, size_t nb, float scale)
+{
+	const uint8_t *s = src;
+	__m128i shift = _mm_cvtsi32_si128((int) plan->shift),
+		ext = _mm_cvtsi32_si128((int) (32 - plan->bits));
+	__m256i mask = _mm256_set1_epi32((int) plan->mask);
+	__m256 mul = _mm256_set1_ps(scale);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (s + i * 4));
+
+		v = avx2_convert_32(plan, v, shift, ext, mask);
+		_mm256_storeu_ps(dst + i,
+				_mm256_mul_ps(_mm256_cvtepi32_ps(v), mul));
+	}
+
+	to_float_scalar_32(plan, dst + i, s + i * 4, nb - i, scale);
+}
+
+#endif /* HAS_X86_KERNELS */
+
+#ifdef HAS_NEON_KERNELS
+
+static void convert_neon_16(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	int16x8_t shift = vdupq_n_s16(-(int16_t) plan->shift),
+		  ext = vdupq_n_s16((int16_t) (16 - plan->bits)),
+		  unext = vdupq_n_s16(-(int16_t) (16 - plan->bits));
+	uint16x8_t mask = vdupq_n_u16((uint16_t) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		uint16x8_t v = vld1q_u16((const uint16_t *) (s + i * 2));
+
+		if (plan->swap)
+			v = vreinterpretq_u16_u8(vrev16q_u8(
+						vreinterpretq_u8_u16(v)));
+		v = vshlq_u16(v, shift);
+		if (plan->sign_extend)
+			v = vreinterpretq_u16_s16(vshlq_s16(vshlq_s16(
+					vreinterpretq_s16_u16(v), ext), unext));
+		else if (plan->mask_convert)
+			v = vandq_u16(v, mask);
+		vst1q_u16((uint16_t *) (d + i * 2), v);
+	}
+
+	convert_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+static void convert_inverse_neon_16(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	int16x8_t shift = vdupq_n_s16((int16_t) plan->shift);
+	uint16x8_t mask = vdupq_n_u16((uint16_t) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		uint16x8_t v = vld1q_u16((const uint16_t *) (s + i * 2));
+
+		if (plan->mask_bits)
+			v = vandq_u16(v, mask);
+		v = vshlq_u16(v, shift);
+		if (plan->swap)
+			v = vreinterpretq_u16_u8(vrev16q_u8(
+						vreinterpretq_u8_u16(v)));
+		vst1q_u16((uint16_t *) (d + i * 2), v);
+	}
+
+	convert_inverse_scalar_16(plan, d + i * 2, s + i * 2, nb - i);
+}
+
+static void convert_neon_32(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	int32x4_t shift = vdupq_n_s32(-(int32_t) plan->shift),
+		  ext = vdupq_n_s32((int32_t) (32 - plan->bits)),
+		  unext = vdupq_n_s32(-(int32_t) (32 - plan->bits));
+	uint32x4_t mask = vdupq_n_u32((uint32_t) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		uint32x4_t v = vld1q_u32((const uint32_t *) (s + i * 4));
+
+		if (plan->swap)
+			v = vreinterpretq_u32_u8(vrev32q_u8(
+						vreinterpretq_u8_u32(v)));
+		v = vshlq_u32(v, shift);
+		if (plan->sign_extend)
+			v = vreinterpretq_u32_s32(vshlq_s32(vshlq_s32(
+					vreinterpretq_s32_u32(v), ext), unext));
+		else if (plan->mask_convert)
+			v = vandq_u32(v, mask);
+		vst1q_u32((uint32_t *) (d + i * 4), v);
+	}
+
+	convert_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+static void convert_inverse_neon_32(const struct iio_convert_plan *plan,
+		void *dst, const void *src, size_t nb)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	int32x4_t shift = vdupq_n_s32((int32_t) plan->shift);
+	uint32x4_t mask = vdupq_n_u32((uint32_t) plan->mask);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		uint32x4_t v = vld1q_u32((const uint32_t *) (s + i * 4));
+
+		if (plan->mask_bits)
+			v = vandq_u32(v, mask);
+		v = vshlq_u32(v, shift);
+		if (plan->swap)
+			v = vreinterpretq_u32_u8(vrev32q_u8(
+						vreinterpretq_u8_u32(v)));
+		vst1q_u32((uint32_t *) (d + i * 4), v);
+	}
+
+	convert_inverse_scalar_32(plan, d + i * 4, s + i * 4, nb - i);
+}
+
+#endif /* HAS_NEON_KERNELS */
+
+/* Dot product of two arrays of floats: the inner loop of the FIR filters.
+ * The SIMD versions sum in a different order, and may differ from the
+ * scalar one in the last bits. */
+static float dot_scalar(const float *a, const float *b, size_t nb)
+{
+	float sum = 0.0f;
+	size_t i;
+
+	for (i = 0; i < nb; i++)
+		sum += a[i] * b[i];
+	return sum;
+}
+
+#ifdef HAS_X86_KERNELS
+static __sse2 float dot_sse2(const float *a, const float *b, size_t nb)
+{
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	float sum[4];
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),
+					_mm_loadu_ps(b + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+					_mm_loadu_ps(b + i + 4)));
+	}
+
+	_mm_storeu_ps(sum, _mm_add_ps(acc0, acc1));
+	return sum[0] + sum[1] + sum[2] + sum[3] +
+		dot_scalar(a + i, b + i, nb - i);
+}
+
+static __target("avx2") float dot_avx2(const float *a, const float *b,
+		size_t nb)
+{
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	float sum[4];
+	size_t i;
+
+	for (i = 0; i + 16 <= nb; i += 16) {
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(
+					_mm256_loadu_ps(a + i),
+					_mm256_loadu_ps(b + i)));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(
+					_mm256_loadu_ps(a + i + 8),
+					_mm256_loadu_ps(b + i + 8)));
+	}
+
+	acc0 = _mm256_add_ps(acc0, acc1);
+	_mm_storeu_ps(sum, _mm_add_ps(_mm256_castps256_ps128(acc0),
+				_mm256_extractf128_ps(acc0, 1)));
+	return sum[0] + sum[1] + sum[2] + sum[3] +
+		dot_scalar(a + i, b + i, nb - i);
+}
+#endif /* HAS_X86_KERNELS */
+
+#ifdef HAS_NEON_KERNELS
+static float dot_neon(const float *a, const float *b, size_t nb)
+{
+	float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+	float sum[4];
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+		acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4),
+				vld1q_f32(b + i + 4));
+	}
+
+	vst1q_f32(sum, vaddq_f32(acc0, acc1));
+	return sum[0] + sum[1] + sum[2] + sum[3] +
+		dot_scalar(a + i, b + i, nb - i);
+}
+#endif /* HAS_NEON_KERNELS */
+
+/* Trigger comparators: index of the first sample of x[0..nb) meeting the
+ * condition, x[-1] being the sample before x[0]; nb if there is none. NaN
+ * samples never fire a trigger, and are neither above nor below. */
+static inline bool trigger_one(float prev, float cur, float threshold,
+		enum iio_trigger_mode mode)
+{
+	switch (mode) {
+	case IIO_TRIGGER_RISING:
+		return prev < threshold && cur >= threshold;
+	case IIO_TRIGGER_FALLING:
+		return prev >= threshold && cur < threshold;
+	case IIO_TRIGGER_EDGE:
+		return (prev < threshold && cur >= threshold) ||
+			(prev >= threshold && cur < threshold);
+	case IIO_TRIGGER_HIGH:
+		return cur >= threshold;
+	default:
+		return cur < threshold;
+	}
+}
+
+static size_t trigger_scalar(const float *x, size_t nb, float threshold,
+		enum iio_trigger_mode mode)
+{
+	size_t i;
+
+	for (i = 0; i < nb; i++)
+		if (trigger_one(x[i - 1], x[i], threshold, mode))
+			return i;
+	return nb;
+}
+
+#ifdef HAS_X86_KERNELS
+static __sse2 size_t trigger_sse2(const float *x, size_t nb,
+		float threshold, enum iio_trigger_mode mode)
+{
+	__m128 thr = _mm_set1_ps(threshold);
+	size_t i;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		__m128 cur = _mm_loadu_ps(x + i), prev = _mm_loadu_ps(x + i - 1),
+		       below = _mm_cmplt_ps(cur, thr),
+		       above = _mm_cmpge_ps(cur, thr), hit;
+		int bits;
+
+		switch (mode) {
+		case IIO_TRIGGER_RISING:
+			hit = _mm_and_ps(_mm_cmplt_ps(prev, thr), above);
+			break;
+		case IIO_TRIGGER_FALLING:
+			hit = _mm_and_ps(_mm_cmpge_ps(prev, thr), below);
+			break;
+		case IIO_TRIGGER_EDGE:
+			hit = _mm_or_ps(
+				_mm_and_ps(_mm_cmplt_ps(prev, thr), above),
+				_mm_and_ps(_mm_cmpge_ps(prev, thr), below));
+			break;
+		case IIO_TRIGGER_HIGH:
+			hit = above;
+			break;
+		default:
+			hit = below;
+			break;
+		}
+
+		bits = _mm_movemask_ps(hit);
+		if (bits)
+			return i + (size_t) __builtin_ctz((unsigned int) bits);
+	}
+
+	return i + trigger_scalar(x + i, nb - i, threshold, mode);
+}
+
+static __target("avx2") size_t trigger_avx2(const float *x, size_t nb,
+		float threshold, enum iio_trigger_mode mode)
+{
+	__m256 thr = _mm256_set1_ps(threshold);
+	size_t i;
+
+	for (i = 0; i + 8 <= nb; i += 8) {
+		__m256 cur = _mm256_loadu_ps(x + i),
+		       prev = _mm256_loadu_ps(x + i - 1),
+		       below = _mm256_cmp_ps(cur, thr, _CMP_LT_OQ),
+		       above = _mm256_cmp_ps(cur, thr, _CMP_GE_OQ), hit;
+		int bits;
+
+		switch (mode) {
+		case IIO_TRIGGER_RISING:
+			hit = _mm256_and_ps(_mm256_cmp_ps(prev, thr,
+						_CMP_LT_OQ), above);
+			break;
+		case IIO_TRIGGER_FALLING:
+			hit = _mm256_and_ps(_mm256_cmp_ps(prev, thr,
+						_CMP_GE_OQ), below);
+			break;
+		case IIO_TRIGGER_EDGE:
+			hit = _mm256_or_ps(
+				_mm256_and_ps(_mm256_cmp_ps(prev, thr,
+						_CMP_LT_OQ), above),
+				_mm256_and_ps(_mm256_cmp_ps(prev, thr,
+						_CMP_GE_OQ), below));
+			break;
+		case IIO_TRIGGER_HIGH:
+			hit = above;
+			break;
+		default:
+			hit = below;
+			break;
+		}
+
+		bits = _mm256_movemask_ps(hit);
+		if (bits)
+			return i + (size_t) __builtin_ctz((unsigned int) bits);
+	}
+
+	return i + trigger_scalar(x + i, nb - i, threshold, mode);
+}
+#endif /* HAS_X86_KERNELS */
+
+#ifdef HAS_NEON_KERNELS
+static size_t trigger_neon(const float *x, size_t nb, float threshold,
+		enum iio_trigger_mode mode)
+{
+	float32x4_t thr = vdupq_n_f32(threshold);
+	uint32_t bits[4];
+	size_t i, j;
+
+	for (i = 0; i + 4 <= nb; i += 4) {
+		float32x4_t cur = vld1q_f32(x + i), prev = vld1q_f32(x + i - 1);
+		uint32x4_t below = vcltq_f32(cur, thr),
+			   above = vcgeq_f32(cur, thr), hit;
+
+		switch (mode) {
+		case IIO_TRIGGER_RISING:
+			hit = vandq_u32(vcltq_f32(prev, thr), above);
+			break;
+		case IIO_TRIGGER_FALLING:
+			hit = vandq_u32(vcgeq_f32(prev, thr), below);
+			break;
+		case IIO_TRIGGER_EDGE:
+			hit = vorrq_u32(vandq_u32(vcltq_f32(prev, thr), above),
+					vandq_u32(vcgeq_f32(prev, thr), below));
+			break;
+		case IIO_TRIGGER_HIGH:
+			hit = above;
+			break;
+		default:
+			hit = below;
+			break;
+		}
+
+		vst1q_u32(bits, hit);
+		for (j = 0; j < 4; j++)
+			if (bits[j])
+				return i + j;
+	}
+
+	return i + trigger_scalar(x + i, nb - i, threshold, mode);
+}
+#endif /* HAS_NEON_KERNELS */
+
+enum iio_simd_level {
+	IIO_SIMD_NONE,
+	IIO_SIMD_SSE2,
+	IIO_SIMD_AVX2,
+	IIO_SIMD_NEON,
+};
+
+static enum iio_simd_level get_simd_level(void)
+{
+#if defined(HAS_X86_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return IIO_SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return IIO_SIMD_SSE2;
+#elif defined(HAS_NEON_KERNELS)
+	return IIO_SIMD_NEON;
+#endif
+	return IIO_SIMD_NONE;
+}
+
+void iio_convert_plan_init(struct iio_convert_plan *plan,
+		const struct iio_data_format *fmt)
+{
+	enum iio_simd_level level = get_simd_level();
+	unsigned int width = fmt->length;
+
+	memset(plan, 0, sizeof(*plan));
+
+	/* Only power-of-two sample sizes up to 64 bits have a bulk kernel;
+	 * anything else goes through the generic byte-wise code. */
+	if (width != 8 && width != 16 && width != 32 && width != 64)
+		return;
+	if (!fmt->bits || fmt->bits > width || fmt->shift >= width)
+		return;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	plan->swap = width > 8 && fmt->is_be;
+#else
+	plan->swap = width > 8 && !fmt->is_be;
+#endif
+	plan->shift = fmt->shift;
+	plan->bits = fmt->bits;
+	plan->mask_bits = fmt->bits < width;
+	plan->mask = plan->mask_bits ? (UINT64_C(1) << fmt->bits) - 1 : 0;
+	plan->sign_extend = !fmt->is_fully_defined && fmt->is_signed;
+	plan->mask_convert = !fmt->is_fully_defined && !fmt->is_signed &&
+		plan->mask_bits;
+	plan->is_signed = fmt->is_signed;
+
+	if (fmt->is_signed) {
+		plan->qmax = (UINT64_C(1) << (fmt->bits - 1)) - 1;
+		plan->qmin = ~plan->qmax;
+		plan->fmin = (float) (int64_t) plan->qmin;
+		plan->fmax = (float) plan->qmax;
+	} else {
+		plan->qmax = fmt->bits < 64 ?
+			(UINT64_C(1) << fmt->bits) - 1 : UINT64_MAX;
+		plan->qmin = 0;
+		plan->fmin = 0.0f;
+		plan->fmax = (float) plan->qmax;
+	}
+
+#define SET_SCALAR_KERNELS(width)					\
+	plan->convert = convert_scalar_##width;				\
+	plan->convert_inverse = convert_inverse_scalar_##width;		\
+	plan->to_float = to_float_scalar_##width;			\
+	plan->to_double = to_double_scalar_##width;			\
+	plan->from_float = from_float_scalar_##width;			\
+	plan->from_int16 = from_int16_scalar_##width;			\
+	plan->quantize = quantize_scalar_##width;			\
+	plan->stats = stats_scalar_##width
+
+	switch (width) {
+	case 8:
+		SET_SCALAR_KERNELS(8);
+		break;
+	case 16:
+		SET_SCALAR_KERNELS(16);
+		break;
+	case 32:
+		SET_SCALAR_KERNELS(32);
+		break;
+	default:
+		SET_SCALAR_KERNELS(64);
+		break;
+	}
+
+#undef SET_SCALAR_KERNELS
+
+	switch (level) {
+#ifdef HAS_X86_KERNELS
+	case IIO_SIMD_AVX2:
+		if (width == 16) {
+			plan->convert = convert_avx2_16;
+			plan->convert_inverse = convert_inverse_avx2_16;
+			plan->to_float = to_float_avx2_16;
+			plan->from_float = from_float_avx2_16;
+			plan->from_int16 = from_int16_avx2_16;
+			if (fmt->is_signed)
+				plan->stats = stats_avx2_16;
+		} else if (width == 32) {
+			plan->convert = convert_avx2_32;
+			plan->convert_inverse = convert_inverse_avx2_32;
+			if (fmt->is_signed || plan->mask_convert)
+				plan->to_float = to_float_avx2_32;
+		}
+		break;
+	case IIO_SIMD_SSE2:
+		if (width == 16) {
+			plan->convert = convert_sse2_16;
+			plan->convert_inverse = convert_inverse_sse2_16;
+			plan->to_float = to_float_sse2_16;
+			plan->from_float = from_float_sse2_16;
+			plan->from_int16 = from_int16_sse2_16;
+			if (fmt->is_signed)
+				plan->stats = stats_sse2_16;
+		} else if (width == 32) {
+			plan->convert = convert_sse2_32;
+			plan->convert_inverse = convert_inverse_sse2_32;
+			if (fmt->is_signed || plan->mask_convert)
+				plan->to_float = to_float_sse2_32;
+		}
+		break;
+#endif
+#ifdef HAS_NEON_KERNELS
+	case IIO_SIMD_NEON:
+		if (width == 16) {
+			plan->convert = convert_neon_16;
+			plan->convert_inverse = convert_inverse_neon_16;
+		} else if (width == 32) {
+			plan->convert = convert_neon_32;
+			plan->convert_inverse = convert_inverse_neon_32;
+		}
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+iio_dot_kernel iio_get_dot_kernel(void)
+{
+	switch (get_simd_level()) {
+#ifdef HAS_X86_KERNELS
+	case IIO_SIMD_AVX2:
+		return dot_avx2;
+	case IIO_SIMD_SSE2:
+		return dot_sse2;
+#endif
+#ifdef HAS_NEON_KERNELS
+	case IIO_SIMD_NEON:
+		return dot_neon;
+#endif
+	default:
+		return dot_scalar;
+	}
+}
+
+iio_trigger_kernel iio_get_trigger_kernel(void)
+{
+	switch (get_simd_level()) {
+#ifdef HAS_X86_KERNELS
+	case IIO_SIMD_AVX2:
+		return trigger_avx2;
+	case IIO_SIMD_SSE2:
+		return trigger_sse2;
+#endif
+#ifdef HAS_NEON_KERNELS
+	case IIO_SIMD_NEON:
+		return trigger_neon;
+#endif
+	default:
+		return trigger_scalar;
+	}
+}
@@ -0,0 +1,277 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include "iio-private.h"
+
+#include <errno.h>
+#include <string.h>
+
+/*
+ * FIR decimators: right after each refill, the samples of a channel are
+ * converted to floats one tile at a time, and filtered while the tile is
+ * still in the cache. Only one output every 'factor' inputs is computed,
+ * which is what a polyphase decimator amounts to when the filter runs on
+ * the CPU. The last nb_taps - 1 inputs are kept from one tile, and one
+ * refill, to the next, so that the output is the same as if the whole
+ * stream had been filtered at once.
+ */
+
+/* Number of samples converted and filtered at once */
+#define DECIMATOR_TILE 256
+
+struct iio_decimator {
+	const struct iio_channel *chn;
+	iio_dot_kernel dot;
+	unsigned int factor, nb_taps;
+
+	/* Index in the next tile of the next input to compute an output at */
+	unsigned int phase;
+
+	/* The taps in reverse order, so that each output is one dot product
+	 * with the inputs in memory order */
+	float *taps;
+
+	/* The last nb_taps - 1 inputs of the previous tile, followed by the
+	 * inputs of the current one */
+	float *work;
+
+	/* Outputs of the last refill, not quantized yet */
+	float *out;
+	size_t nb_out, out_size;
+};
+
+static struct iio_decimator * find_decimator(const struct iio_buffer *buf,
+		const struct iio_channel *chn, unsigned int *idx)
+{
+	unsigned int i;
+
+	for (i = 0; i < buf->nb_decimators; i++) {
+		if (buf->decimators[i]->chn == chn) {
+			if (idx)
+				*idx = i;
+			return buf->decimators[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void free_decimator(struct iio_decimator *dec)
+{
+	free(dec->out);
+	free(dec->work);
+	free(dec->taps);
+	free(dec);
+}
+
+int iio_buffer_add_decimator(struct iio_buffer *buf,
+		const struct iio_channel *chn, unsigned int factor,
+		const float *taps, size_t nb_taps)
+{
+	struct iio_decimator *dec, **decimators;
+	size_t i;
+
+	if (!factor || !taps || !nb_taps || buf->is_output ||
+			chn->dev != buf->dev || !chn->is_scan_element ||
+			chn->format.repeat > 1)
+		return -EINVAL;
+	if (!chn->convert.to_float || !chn->convert.quantize)
+		return -ENOSYS;
+	if (find_decimator(buf, chn, NULL))
+		return -EEXIST;
+
+	dec = zalloc(sizeof(*dec));
+	if (!dec)
+		return -ENOMEM;
+
+	dec->chn = chn;
+	dec->dot = iio_get_dot_kernel();
+	dec->factor = factor;
+	dec->nb_taps = (unsigned int) nb_taps;
+
+	dec->taps = malloc(nb_taps * sizeof(*dec->taps));
+	if (!dec->taps)
+		goto err_free_decimator;
+
+	for (i = 0; i < nb_taps; i++)
+		dec->taps[i] = taps[nb_taps - i - 1];
+
+	dec->work = calloc(nb_taps - 1 + DECIMATOR_TILE, sizeof(*dec->work));
+	if (!dec->work)
+		goto err_free_decimator;
+
+	decimators = realloc(buf->decimators,
+			(buf->nb_decimators + 1) * sizeof(*decimators));
+	if (!decimators)
+		goto err_free_decimator;
+
+	decimators[buf->nb_decimators++] = dec;
+	buf->decimators = decimators;
+	return 0;
+
+err_free_decimator:
+	free_decimator(dec);
+	return -ENOMEM;
+}
+
+int iio_buffer_remove_decimator(struct iio_buffer *buf,
+		const struct iio_channel *chn)
+{
+	struct iio_decimator *dec;
+	unsigned int idx;
+
+	dec = find_decimator(buf, chn, &idx);
+	if (!dec)
+		return -ENOENT;
+
+	free_decimator(dec);
+	memmove(&buf->decimators[idx], &buf->decimators[idx + 1],
+			(buf->nb_decimators - idx - 1) *
+			sizeof(*buf->decimators));
+	buf->nb_decimators--;
+	return 0;
+}
+
+void iio_buffer_free_decimators(struct iio_buffer *buf)
+{
+	unsigned int i;
+
+	for (i = 0; i < buf->nb_decimators; i++)
+		free_decimator(buf->decimators[i]);
+
+	free(buf->decimators);
+	buf->decimators = NULL;
+	buf->nb_decimators = 0;
+}
+
+static int decimator_run(struct iio_decimator *dec,
+		const struct iio_buffer *buf)
+{
+	const struct iio_channel *chn = dec->chn;
+	const struct iio_convert_plan *plan = &chn->convert;
+	unsigned int length = chn->format.length / 8, hist = dec->nb_taps - 1;
+	uintptr_t src_ptr = (uintptr_t) iio_buffer_first(buf, chn);
+	uintptr_t buf_end = (uintptr_t) iio_buffer_end(buf);
+	ptrdiff_t buf_step = iio_buffer_step(buf);
+	uint64_t tmp[DECIMATOR_TILE];
+	size_t i, n, tile, nb = 0, max_out;
+
+	dec->nb_out = 0;
+
+	if (src_ptr < buf_end)
+		nb = (buf_end - src_ptr + buf_step - 1) / buf_step;
+
+	max_out = nb / dec->factor + 1;
+	if (max_out > dec->out_size) {
+		float *out = realloc(dec->out, max_out * sizeof(*out));
+
+		if (!out)
+			return -ENOMEM;
+
+		dec->out = out;
+		dec->out_size = max_out;
+	}
+
+	for (i = 0; i < nb; i += tile) {
+		const void *raw = tmp;
+
+		tile = nb - i;
+		if (tile > DECIMATOR_TILE)
+			tile = DECIMATOR_TILE;
+
+		/* Only gather the samples when they are not contiguous */
+		if (buf_step == (ptrdiff_t) length)
+			raw = (const void *) src_ptr;
+		else
+			iio_copy_strided((uintptr_t) tmp, length,
+					src_ptr, buf_step, length, tile);
+
+		plan->to_float(plan, dec->work + hist, raw, tile, 1.0f);
+
+		for (n = dec->phase; n < tile; n += dec->factor)
+			dec->out[dec->nb_out++] = dec->dot(dec->taps,
+					dec->work + n, dec->nb_taps);
+
+		dec->phase = (unsigned int) (n - tile);
+		memmove(dec->work, dec->work + tile,
+				hist * sizeof(*dec->work));
+		src_ptr += tile * buf_step;
+	}
+
+	return 0;
+}
+
+int iio_buffer_run_decimators(struct iio_buffer *buf)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < buf->nb_decimators; i++) {
+		ret = decimator_run(buf->decimators[i], buf);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+ssize_t iio_buffer_read_decimated(const struct iio_buffer *buf,
+		const struct iio_channel *chn, void *dst, size_t len,
+		enum iio_decimated_type type)
+{
+	const struct iio_decimator *dec = find_decimator(buf, chn, NULL);
+	size_t i, nb, size;
+	double scale;
+
+	if (!dec)
+		return -ENOENT;
+
+	switch (type) {
+	case IIO_DECIMATED_FLOAT:
+		size = sizeof(float);
+		break;
+	case IIO_DECIMATED_DOUBLE:
+		size = sizeof(double);
+		break;
+	default:
+		size = chn->format.length / 8;
+		break;
+	}
+
+	nb = len / size;
+	if (nb > dec->nb_out)
+		nb = dec->nb_out;
+
+	switch (type) {
+	case IIO_DECIMATED_FLOAT:
+		scale = iio_channel_get_scale(chn);
+		for (i = 0; i < nb; i++)
+			((float *) dst)[i] = dec->out[i] * (float) scale;
+		break;
+	case IIO_DECIMATED_DOUBLE:
+		scale = iio_channel_get_scale(chn);
+		for (i = 0; i < nb; i++)
+			((double *) dst)[i] = (double) dec->out[i] * scale;
+		break;
+	default:
+		chn->convert.quantize(&chn->convert, dst, dec->out, nb);
+		break;
+	}
+
+	return (ssize_t) (nb * size);
+}
@@ -207,6 +207,69 @@ struct iio_channel * iio_device_find_channel(const struct iio_device *dev,
 	return NULL;
 }
 
+/* I and Q channels pair up when they have the same type, direction and ID,
+ * except for their modifier, e.g. "voltage0_i" and "voltage0_q". */
+static bool is_iq_pair(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn)
+{
+	size_t pos;
+
+	if (i_chn->modifier != IIO_MOD_I || q_chn->modifier != IIO_MOD_Q ||
+			i_chn->type != q_chn->type ||
+			i_chn->is_output != q_chn->is_output ||
+			strlen(i_chn->id) != strlen(q_chn->id))
+		return false;
+
+	/* The modifier always follows the first underscore */
+	pos = strchr(i_chn->id, '_') - i_chn->id + 1;
+	return !strncmp(i_chn->id, q_chn->id, pos) &&
+		!strcmp(i_chn->id + pos + 1, q_chn->id + pos + 1);
+}
+
+static struct iio_channel * find_q_channel(const struct iio_device *dev,
+		const struct iio_channel *i_chn)
+{
+	unsigned int i;
+
+	for (i = 0; i < dev->nb_channels; i++)
+		if (is_iq_pair(i_chn, dev->channels[i]))
+			return dev->channels[i];
+	return NULL;
+}
+
+unsigned int iio_device_get_iq_pairs_count(const struct iio_device *dev)
+{
+	unsigned int i, nb = 0;
+
+	for (i = 0; i < dev->nb_channels; i++)
+		if (dev->channels[i]->modifier == IIO_MOD_I &&
+				find_q_channel(dev, dev->channels[i]))
+			nb++;
+	return nb;
+}
+
+int iio_device_get_iq_pair(const struct iio_device *dev, unsigned int index,
+		struct iio_channel **i_chn, struct iio_channel **q_chn)
+{
+	unsigned int i;
+
+	for (i = 0; i < dev->nb_channels; i++) {
+		struct iio_channel *chn = dev->channels[i], *q;
+
+		if (chn->modifier != IIO_MOD_I)
+			continue;
+
+		q = find_q_channel(dev, chn);
+		if (q && !index--) {
+			*i_chn = chn;
+			*q_chn = q;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
 unsigned int iio_device_get_attrs_count(const struct iio_device *dev)
 {
 	return dev->nb_attrs;
@@ -93,11 +93,25 @@ struct iio_backend_ops {
 	struct iio_context * (*clone)(const struct iio_context *ctx);
 	ssize_t (*read)(const struct iio_device *dev, void *dst, size_t len,
 			uint32_t *mask, size_t words);
+	/* Same as read, but returns as soon as min_len bytes were read */
+	ssize_t (*read_min)(const struct iio_device *dev, void *dst,
+			size_t len, size_t min_len,
+			uint32_t *mask, size_t words);
+	/* Same as read, but only returns the statistics of the channels of
+	 * the mask, indexed by channel number */
+	ssize_t (*read_stats)(const struct iio_device *dev, size_t len,
+			uint32_t *mask, size_t words,
+			struct iio_channel_stats *stats);
 	ssize_t (*write)(const struct iio_device *dev,
 			const void *src, size_t len);
 	int (*open)(const struct iio_device *dev,
 			size_t samples_count, bool cyclic);
 	int (*close)(const struct iio_device *dev);
+
+	/* Apply the device's current channel mask and a new number of
+	 * samples to an opened device, keeping what can be kept open */
+	int (*reconfigure)(const struct iio_device *dev,
+			size_t samples_count);
 	int (*get_fd)(const struct iio_device *dev);
 	int (*set_blocking_mode)(const struct iio_device *dev, bool blocking);
 
@@ -109,6 +123,14 @@ struct iio_backend_ops {
 			void **addr_ptr, size_t bytes_used,
 			uint32_t *mask, size_t words);
 
+	/* Unlike get_buffer, which holds a single block at a time, these
+	 * take memory-mapped blocks out of the kernel's queue and give them
+	 * back individually, in any order */
+	ssize_t (*dequeue_block)(const struct iio_device *dev,
+			unsigned int *id, void **addr_ptr);
+	int (*enqueue_block)(const struct iio_device *dev,
+			unsigned int id, size_t bytes_used);
+
 	ssize_t (*read_device_attr)(const struct iio_device *dev,
 			const char *attr, char *dst, size_t len, bool is_debug);
 	ssize_t (*write_device_attr)(const struct iio_device *dev,
@@ -135,6 +157,11 @@ struct iio_backend_ops {
 struct iio_context_pdata;
 struct iio_device_pdata;
 struct iio_channel_pdata;
+struct iio_buffer_async;
+struct iio_buffer_stream;
+struct iio_buffer_fanout;
+struct iio_decimator;
+struct iio_capture;
 struct iio_scan_backend_context;
 
 struct iio_channel_attr {
@@ -158,6 +185,43 @@ struct iio_context {
 	unsigned int nb_attrs;
 };
 
+/* Conversion of a channel's samples between the hardware format and the
+ * CPU format, prepared once from the channel's data format. 'convert' and
+ * 'convert_inverse' process 'nb' contiguous elements of fmt->length bits
+ * and are NULL when the format has no bulk kernel. */
+struct iio_convert_plan {
+	void (*convert)(const struct iio_convert_plan *plan,
+			void *dst, const void *src, size_t nb);
+	void (*convert_inverse)(const struct iio_convert_plan *plan,
+			void *dst, const void *src, size_t nb);
+
+	/* Same as 'convert' followed by a multiplication by 'scale', and
+	 * the reverse operations, quantizing with saturation to 'bits' */
+	void (*to_float)(const struct iio_convert_plan *plan,
+			float *dst, const void *src, size_t nb, float scale);
+	void (*to_double)(const struct iio_convert_plan *plan,
+			double *dst, const void *src, size_t nb, double scale);
+	void (*from_float)(const struct iio_convert_plan *plan,
+			void *dst, const float *src, size_t nb, float scale);
+	void (*from_int16)(const struct iio_convert_plan *plan,
+			void *dst, const int16_t *src, size_t nb);
+
+	/* Round and saturate floats to the range of the channel, leaving
+	 * the integers in the CPU format */
+	void (*quantize)(const struct iio_convert_plan *plan,
+			void *dst, const float *src, size_t nb);
+
+	/* Accumulate the statistics of integers in the CPU format */
+	void (*stats)(const struct iio_convert_plan *plan,
+			struct iio_channel_stats *stats,
+			const void *src, size_t nb);
+
+	unsigned int shift, bits;
+	uint64_t mask, qmin, qmax;
+	float fmin, fmax;
+	bool swap, sign_extend, mask_convert, mask_bits, is_signed;
+};
+
 struct iio_channel {
 	struct iio_device *dev;
 	struct iio_channel_pdata *pdata;
@@ -175,6 +239,8 @@ struct iio_channel {
 	unsigned int nb_attrs;
 
 	unsigned int number;
+
+	struct iio_convert_plan convert;
 };
 
 struct iio_device {
@@ -195,6 +261,17 @@ struct iio_device {
 
 	uint32_t *mask;
 	size_t words;
+
+	/* Buffer opened on the device, if any. Lets the backends record
+	 * what only they can see (statistics, remote latencies). */
+	struct iio_buffer *buffer;
+};
+
+/* Position of one channel's data within a sample of an iio_buffer */
+struct iio_channel_layout {
+	const struct iio_channel *chn;
+	size_t offset;
+	unsigned int length, repeat;
 };
 
 struct iio_buffer {
@@ -205,7 +282,69 @@ struct iio_buffer {
 	uint32_t *mask;
 	unsigned int dev_sample_size;
 	unsigned int sample_size;
-	bool is_output, dev_is_high_speed;
+	bool is_output, dev_is_high_speed, cyclic, cancelled;
+
+	/* Set if 'buffer' was provided by the application, or is a mapping
+	 * of 'mmap_length' bytes of huge pages */
+	bool user_memory, hugepages;
+	size_t mmap_length;
+
+	/* Size of the memory pointed to by 'buffer', unless it is one of the
+	 * kernel's DMA blocks */
+	size_t capacity;
+
+	/* Offset of the first sample of each channel, indexed by channel
+	 * number, and the channels present in the buffer in sample order.
+	 * Rebuilt from 'mask' each time it changes; 'layout_mask' holds the
+	 * mask they were computed from. */
+	size_t *offsets;
+	struct iio_channel_layout *layout;
+	unsigned int nb_layout;
+	uint32_t *layout_mask;
+
+	struct iio_buffer_stats stats;
+	uint64_t last_refill_ns;
+
+	/* Completion time of the current samples (CLOCK_MONOTONIC) */
+	uint64_t timestamp;
+
+	/* Latencies reported by a remote backend for the current samples */
+	uint64_t server_latency_ns, transport_latency_ns;
+	bool has_remote_latency;
+
+	/* Scan element of type IIO_TIMESTAMP, if enabled */
+	const struct iio_channel *timestamp_chn;
+
+	/* Blocks and worker thread of the asynchronous API, if started */
+	struct iio_buffer_async *async;
+
+	/* Blocks and refill thread of the streaming mode, if started */
+	struct iio_buffer_stream *stream;
+
+	/* Blocks, refill thread and consumers of the fan-out, if started */
+	struct iio_buffer_fanout *fanout;
+
+	/* Ring mode: 'ring_size' bytes mapped twice in a row at 'ring', so
+	 * that samples wrapping around the end stay contiguous. Refills write
+	 * at 'ring_head'; the 'ring_fill' bytes before it are valid. */
+	char *ring;
+	size_t ring_size, ring_head, ring_fill;
+
+	/* Number of bytes refilled since the ring was started */
+	uint64_t ring_total;
+
+	/* Trigger and capture windows scanned for on the ring, if started */
+	struct iio_capture *capture;
+
+	/* FIR decimators run on each refill, at most one per channel */
+	struct iio_decimator **decimators;
+	unsigned int nb_decimators;
+
+	/* Handles of the DMA blocks given by iio_buffer_dequeue_block,
+	 * indexed by kernel block ID, and the lock protecting them */
+	struct iio_block **dma_blocks;
+	unsigned int nb_dma_blocks;
+	struct iio_mutex *dma_blocks_lock;
 };
 
 struct iio_context_info {
@@ -229,6 +368,7 @@ char *iio_device_get_xml(const struct iio_device *dev, size_t *len);
 
 char *iio_context_create_xml(const struct iio_context *ctx);
 int iio_context_init(struct iio_context *ctx);
+void iio_context_init_scales(struct iio_context *ctx);
 
 bool iio_device_is_tx(const struct iio_device *dev);
 int iio_device_open(const struct iio_device *dev,
@@ -245,6 +385,7 @@ int read_double(const char *str, double *val);
 int write_double(char *buf, size_t len, double val);
 
 struct iio_context * local_create_context(void);
+struct iio_context * local_create_context_from_uri(const char *uri);
 struct iio_context * network_create_context(const char *hostname);
 struct iio_context * xml_create_context_mem(const char *xml, size_t len);
 struct iio_context * xml_create_context(const char *xml_file);
@@ -265,10 +406,47 @@ int usb_context_scan(struct iio_scan_backend_context *ctx,
 __api ssize_t iio_device_get_sample_size_mask(const struct iio_device *dev,
 		const uint32_t *mask, size_t words);
 
+void iio_buffer_free_blocks(struct iio_buffer *buf);
+int iio_buffer_release_dma_blocks(struct iio_buffer *buf);
+uint64_t iio_buffer_stats_update(struct iio_buffer *buf, bool is_push,
+		uint64_t start_ns, ssize_t ret);
+ssize_t iio_buffer_stream_refill(struct iio_buffer *buf);
+void iio_buffer_stream_set_blocking_mode(struct iio_buffer *buf,
+		bool blocking);
+
+int iio_buffer_run_decimators(struct iio_buffer *buf);
+void iio_buffer_free_decimators(struct iio_buffer *buf);
+void iio_buffer_free_capture(struct iio_buffer *buf);
+
+enum iio_decimated_type {
+	IIO_DECIMATED_CPU,
+	IIO_DECIMATED_FLOAT,
+	IIO_DECIMATED_DOUBLE,
+};
+
+ssize_t iio_buffer_read_decimated(const struct iio_buffer *buf,
+		const struct iio_channel *chn, void *dst, size_t len,
+		enum iio_decimated_type type);
+
 void iio_channel_init_finalize(struct iio_channel *chn);
+double iio_channel_get_scale(const struct iio_channel *chn);
+void iio_convert_plan_init(struct iio_convert_plan *plan,
+		const struct iio_data_format *fmt);
+
+typedef float (*iio_dot_kernel)(const float *a, const float *b, size_t nb);
+iio_dot_kernel iio_get_dot_kernel(void);
+
+typedef size_t (*iio_trigger_kernel)(const float *x, size_t nb,
+		float threshold, enum iio_trigger_mode mode);
+iio_trigger_kernel iio_get_trigger_kernel(void);
+
+void iio_copy_strided(uintptr_t dst, ptrdiff_t dst_step,
+		uintptr_t src, ptrdiff_t src_step,
+		unsigned int length, size_t count);
 unsigned int find_channel_modifier(const char *s, size_t *len_p);
 
 char *iio_strdup(const char *str);
+uint64_t iio_time_ns(void);
 
 int iio_context_add_attr(struct iio_context *ctx,
 		const char *key, const char *value);
@@ -81,6 +81,8 @@ struct iio_context;
 struct iio_device;
 struct iio_channel;
 struct iio_buffer;
+struct iio_block;
+struct iio_buffer_consumer;
 
 struct iio_context_info;
 struct iio_scan_context;
@@ -299,7 +301,13 @@ __api struct iio_context * iio_create_default_context(void);
 
 /** @brief Create a context from local IIO devices (Linux only)
  * @return On success, A pointer to an iio_context structure
- * @return On failure, NULL is returned and errno is set appropriately */
+ * @return On failure, NULL is returned and errno is set appropriately
+ *
+ * <b>NOTE:</b> If the environment variable IIO_LOCAL_ROOT is set, the
+ * devices are looked up below that directory instead of the root of the
+ * filesystem (e.g. in $IIO_LOCAL_ROOT/sys/bus/iio/devices), which allows
+ * the use of a copy of a sysfs tree. The same is done with the URI
+ * "local:root=<path>". */
 __api struct iio_context * iio_create_local_context(void);
 
 
@@ -335,7 +343,11 @@ __api struct iio_context * iio_create_network_context(const char *host);
 /** @brief Create a context from a URI description
  * @param uri A URI describing the context location
  * @return On success, a pointer to a iio_context structure
- * @return On failure, NULL is returned and errno is set appropriately */
+ * @return On failure, NULL is returned and errno is set appropriately
+ *
+ * <b>NOTE:</b> The URI "local:" creates a local context; with
+ * "local:root=<path>", the sysfs, debugfs and /dev directories are looked
+ * up below the given path. */
 __api struct iio_context * iio_create_context_from_uri(const char *uri);
 
 
@@ -536,6 +548,29 @@ __api __pure struct iio_channel * iio_device_find_channel(
 		const struct iio_device *dev, const char *name, bool output);
 
 
+/** @brief Get the number of I/Q channel pairs of the given device
+ * @param dev A pointer to an iio_device structure
+ * @return The number of I/Q channel pairs of the device
+ *
+ * <b>NOTE:</b> An I/Q pair is made of two channels of the same type and
+ * direction, with the IIO_MOD_I and IIO_MOD_Q modifiers, whose IDs only
+ * differ by their modifier (e.g. <i>voltage0_i</i> and <i>voltage0_q</i>). */
+__api __pure unsigned int iio_device_get_iq_pairs_count(
+		const struct iio_device *dev);
+
+
+/** @brief Get the I/Q channel pair present at the given index
+ * @param dev A pointer to an iio_device structure
+ * @param index The index corresponding to the I/Q pair
+ * @param i_chn A pointer to a variable that will receive the I channel
+ * @param q_chn A pointer to a variable that will receive the Q channel
+ * @return On success, 0 is returned
+ * @return If the index is invalid, -ENOENT is returned */
+__api int iio_device_get_iq_pair(const struct iio_device *dev,
+		unsigned int index, struct iio_channel **i_chn,
+		struct iio_channel **q_chn);
+
+
 /** @brief Try to find a device-specific attribute by its name
  * @param dev A pointer to an iio_device structure
  * @param name A NULL-terminated string corresponding to the name of the
@@ -1042,6 +1077,98 @@ __api size_t iio_channel_read(const struct iio_channel *chn,
 		struct iio_buffer *buffer, void *dst, size_t len);
 
 
+/** @brief Convert interleaved samples of a given channel, with one array per
+ * repeated element
+ * @param chn A pointer to an iio_channel structure
+ * @param dsts An array of as many pointers as the repeat count of the
+ * channel; the element k of each sample is stored in dsts[k]
+ * @param src A pointer to the first sample of the channel
+ * @param step The distance between two samples, in bytes
+ * @param nb_samples The number of samples to convert
+ * @return On success, the number of samples converted is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The samples do not have to come from an iio_buffer: any
+ * interleaved data works, e.g. a block or a ring window. For the samples of
+ * a buffer, use iio_buffer_first and iio_buffer_step for src and step.
+ * Each array of dsts must hold nb_samples elements of the channel's
+ * storage size. Channels whose storage size is not 8, 16, 32 or 64 bits are
+ * not supported (-ENOSYS). */
+__api ssize_t iio_channel_unpack(const struct iio_channel *chn,
+		void * const *dsts, const void *src, ptrdiff_t step,
+		size_t nb_samples);
+
+
+/** @brief Demultiplex, convert and scale the samples of a given channel
+ * @param chn A pointer to an iio_channel structure
+ * @param buffer A pointer to an iio_buffer structure
+ * @param dst A pointer to the memory area where the scaled samples will be
+ * stored, one float per element
+ * @param len The available length of the memory area, in bytes
+ * @return On success, the size of the scaled data, in bytes
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The samples are multiplied by the scale of the channel (see
+ * iio_data_format), or by 1.0 if the channel has no scale. When a remote
+ * server does not provide it, the scale is read from the <i>scale</i>
+ * attribute of the channel when the context is created. Channels whose
+ * samples are not 8, 16, 32 or 64 bits long are not supported. */
+__api ssize_t iio_channel_read_float(const struct iio_channel *chn,
+		struct iio_buffer *buffer, float *dst, size_t len);
+
+
+/** @brief Demultiplex, convert and scale the samples of a given channel
+ * @param chn A pointer to an iio_channel structure
+ * @param buffer A pointer to an iio_buffer structure
+ * @param dst A pointer to the memory area where the scaled samples will be
+ * stored, one double per element
+ * @param len The available length of the memory area, in bytes
+ * @return On success, the size of the scaled data, in bytes
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> See iio_channel_read_float. */
+__api ssize_t iio_channel_read_double(const struct iio_channel *chn,
+		struct iio_buffer *buffer, double *dst, size_t len);
+
+
+/** @brief Demultiplex and convert the samples of an I/Q channel pair into
+ * interleaved complex floats
+ * @param i_chn A pointer to the I channel
+ * @param q_chn A pointer to the Q channel
+ * @param buffer A pointer to an iio_buffer structure
+ * @param dst A pointer to the memory area where the complex samples will be
+ * stored, as I/Q pairs of floats
+ * @param len The available length of the memory area, in bytes
+ * @return On success, the size of the complex data, in bytes
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Both channels must be enabled in the buffer. The samples are
+ * scaled as with iio_channel_read_float. When the Q samples directly follow
+ * the I samples in the buffer, the pair is converted in a single pass.
+ * See iio_device_get_iq_pair to find the I/Q pairs of a device. */
+__api ssize_t iio_channel_read_iq_float(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn, struct iio_buffer *buffer,
+		float *dst, size_t len);
+
+
+/** @brief Demultiplex and convert the samples of an I/Q channel pair into
+ * interleaved complex 16-bit integers
+ * @param i_chn A pointer to the I channel
+ * @param q_chn A pointer to the Q channel
+ * @param buffer A pointer to an iio_buffer structure
+ * @param dst A pointer to the memory area where the complex samples will be
+ * stored, as I/Q pairs of int16_t
+ * @param len The available length of the memory area, in bytes
+ * @return On success, the size of the complex data, in bytes
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Only channels with 16-bit samples are supported. The samples
+ * are converted as with iio_channel_read, and are not scaled. */
+__api ssize_t iio_channel_read_iq_int16(const struct iio_channel *i_chn,
+		const struct iio_channel *q_chn, struct iio_buffer *buffer,
+		int16_t *dst, size_t len);
+
+
 /** Multiplex the samples of a given channel
  * @param chn A pointer to an iio_channel structure
  * @param buffer A pointer to an iio_buffer structure
@@ -1064,6 +1191,22 @@ __api size_t iio_channel_write(const struct iio_channel *chn,
 		struct iio_buffer *buffer, const void *src, size_t len);
 
 
+/** @brief Scale, convert and multiplex the samples of a given channel
+ * @param chn A pointer to an iio_channel structure
+ * @param buffer A pointer to an iio_buffer structure
+ * @param src A pointer to the memory area where the samples will be read
+ * from, one float per element
+ * @param len The length of the memory area, in bytes
+ * @return On success, the number of bytes actually converted and multiplexed
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The samples are divided by the scale of the channel, rounded
+ * to the nearest integer and saturated to the range of the channel's data
+ * format before being converted as iio_channel_write does. */
+__api ssize_t iio_channel_write_float(const struct iio_channel *chn,
+		struct iio_buffer *buffer, const float *src, size_t len);
+
+
 /** @brief Associate a pointer to an iio_channel structure
  * @param chn A pointer to an iio_channel structure
  * @param data The pointer to be associated */
@@ -1095,7 +1238,11 @@ __api __pure enum iio_modifier iio_channel_get_modifier(
 /** @defgroup Buffer Buffer
  * @{
  * @struct iio_buffer
- * @brief An input or output buffer, used to read or write samples */
+ * @brief An input or output buffer, used to read or write samples
+ *
+ * @struct iio_block
+ * @brief One block of samples of a buffer, exchanged with the asynchronous
+ * functions or with iio_buffer_dequeue_block */
 
 
 /** @brief Retrieve a pointer to the iio_device structure
@@ -1118,6 +1265,67 @@ __api struct iio_buffer * iio_device_create_buffer(const struct iio_device *dev,
 		size_t samples_count, bool cyclic);
 
 
+/** @brief Create an input or output buffer that uses the given memory
+ * @param dev A pointer to an iio_device structure
+ * @param samples_count The number of samples that the buffer should contain
+ * @param cyclic If True, enable cyclic mode
+ * @param mem A pointer to the memory area that will hold the samples
+ * @param len The length of the memory area, in bytes; it must be able to
+ * hold samples_count samples
+ * @return On success, a pointer to an iio_buffer structure
+ * @return On error, NULL is returned, and errno is set to the error code
+ *
+ * <b>NOTE:</b> iio_buffer_refill and iio_buffer_push read and write the
+ * samples directly in the given memory, which must stay valid until the
+ * buffer is destroyed. It is not freed by iio_buffer_destroy.
+ * Devices whose samples are exchanged through memory-mapped kernel blocks
+ * cannot use external memory; errno is then set to ENOSYS. */
+__api struct iio_buffer * iio_device_create_buffer_with_memory(
+		const struct iio_device *dev, size_t samples_count,
+		bool cyclic, void *mem, size_t len);
+
+
+/** @brief Create an input or output buffer whose memory is allocated on
+ * huge pages
+ * @param dev A pointer to an iio_device structure
+ * @param samples_count The number of samples that the buffer should contain
+ * @param cyclic If True, enable cyclic mode
+ * @return On success, a pointer to an iio_buffer structure
+ * @return On error, NULL is returned, and errno is set to the error code
+ *
+ * <b>NOTE:</b> The memory is 2 MiB-aligned and taken from the reserved huge
+ * pages (MAP_HUGETLB) when available, or else marked as eligible for
+ * transparent huge pages. Devices whose samples are exchanged through
+ * memory-mapped kernel blocks keep using those blocks. */
+__api struct iio_buffer * iio_device_create_buffer_hugepages(
+		const struct iio_device *dev, size_t samples_count, bool cyclic);
+
+
+/** @brief Change the enabled channels or the size of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param samples_count The new number of samples that the buffer should
+ * contain
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * The channels enabled or disabled with iio_channel_enable and
+ * iio_channel_disable since the buffer was created (or last reconfigured)
+ * are applied to the buffer, together with the new size. Unlike destroying
+ * the buffer and creating a new one, the device stays opened: the local
+ * backend only writes the scan elements whose state changed, and the
+ * network backend keeps its connection to the server.
+ *
+ * <b>NOTE:</b> The samples present in the buffer are lost. The buffer
+ * cannot be reconfigured while iio_buffer_start_async or
+ * iio_buffer_start_streaming is active, nor while blocks obtained with
+ * iio_buffer_dequeue_block are held (-EBUSY is returned). A buffer created
+ * with iio_device_create_buffer_with_memory cannot grow beyond the memory
+ * that was given; these errors, and -ENOMEM, leave the buffer unchanged.
+ * If the device itself could not be reconfigured, it is closed: the buffer
+ * can then only be destroyed. */
+__api int iio_buffer_reconfigure(struct iio_buffer *buf, size_t samples_count);
+
+
 /** @brief Destroy the given buffer
  * @param buf A pointer to an iio_buffer structure
  *
@@ -1157,6 +1365,25 @@ __api int iio_buffer_set_blocking_mode(struct iio_buffer *buf, bool blocking);
 __api ssize_t iio_buffer_refill(struct iio_buffer *buf);
 
 
+/** @brief Fetch at least a given number of samples from the hardware
+ * @param buf A pointer to an iio_buffer structure
+ * @param min_samples The minimum number of samples to wait for
+ * @return On success, the number of bytes read is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Unlike iio_buffer_refill, which waits until the whole buffer
+ * is filled, this function returns as soon as min_samples samples were
+ * received, along with the samples already available, up to the size of
+ * the buffer. With a low sample rate, this gives the first samples without
+ * waiting for a whole buffer period.
+ * The remote backends return exactly min_samples samples, and ask the
+ * server for a partial refill of its own buffer. Devices that exchange
+ * samples through memory-mapped kernel blocks, and streaming buffers,
+ * always return whole blocks. */
+__api ssize_t iio_buffer_refill_min(struct iio_buffer *buf,
+		size_t min_samples);
+
+
 /** @brief Send the samples to the hardware
  * @param buf A pointer to an iio_buffer structure
  * @return On success, the number of bytes written is returned
@@ -1257,6 +1484,730 @@ __api ssize_t iio_buffer_foreach_sample(struct iio_buffer *buf,
 			void *src, size_t bytes, void *d), void *data);
 
 
+/** @brief Call the supplied callback for each block of samples of each
+ * channel found in a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param callback A pointer to a function to call for each block found
+ * @param block_size The number of samples per block, or 0 to process the
+ * whole buffer as one block
+ * @param data A user-specified pointer that will be passed to the callback
+ * @return number of bytes processed.
+ *
+ * <b>NOTE:</b> The buffer is cut into blocks of block_size samples. For each
+ * block, the callback is called once for each channel, in the order in which
+ * the channels appear in a sample. It receives five arguments:
+ * * A pointer to the iio_channel structure corresponding to the samples,
+ * * A pointer to the first sample of the channel in the block,
+ * * The distance in bytes between two consecutive samples of the channel,
+ * * The number of samples of the channel in the block,
+ * * The user-specified pointer passed to iio_buffer_foreach_block.
+ *
+ * When the distance equals the size of one sample of the channel, the
+ * samples are contiguous in memory.
+ * iio_buffer_foreach_sample is equivalent to a block size of one sample. */
+__api ssize_t iio_buffer_foreach_block(struct iio_buffer *buf,
+		ssize_t (*callback)(const struct iio_channel *chn,
+			void *first, ptrdiff_t step, size_t count, void *d),
+		size_t block_size, void *data);
+
+
+/** @brief Demultiplex the samples of several channels in one pass
+ * @param buf A pointer to an iio_buffer structure
+ * @param chns An array of pointers to the enabled channels to extract
+ * @param dsts An array of destinations, one per channel, each large enough
+ * to hold samples_count samples of its channel
+ * @param nb The number of channels in chns and dsts
+ * @param samples_count The maximum number of samples to extract per channel
+ * @param convert If True, convert the samples as iio_channel_read does;
+ * otherwise copy them raw, as iio_channel_read_raw does
+ * @return On success, the number of samples extracted for each channel
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Unlike calling iio_channel_read once per channel, the buffer
+ * is only traversed once. Destinations aligned to a cache line are filled
+ * one whole cache line at a time. */
+__api ssize_t iio_buffer_deinterleave(struct iio_buffer *buf,
+		struct iio_channel * const *chns, void * const *dsts,
+		unsigned int nb, size_t samples_count, bool convert);
+
+
+/** @brief Convert and multiplex the samples of several channels in one pass
+ * @param buf A pointer to an iio_buffer structure
+ * @param chns An array of pointers to the enabled channels to fill
+ * @param srcs An array of sources, one per channel, each holding
+ * samples_count samples of its channel as int16_t or float values
+ * @param nb The number of channels in chns and srcs
+ * @param samples_count The maximum number of samples to write per channel
+ * @param is_float If True, the sources hold floats, which are scaled as
+ * with iio_channel_write_float; otherwise they hold int16_t values
+ * @return On success, the number of samples written for each channel
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The values are rounded and saturated to the range of each
+ * channel's data format, then shifted and byte-swapped as
+ * iio_channel_write does. The buffer is filled one block of samples at a
+ * time for all the channels, instead of being walked once per channel. */
+__api ssize_t iio_buffer_interleave(struct iio_buffer *buf,
+		struct iio_channel * const *chns, const void * const *srcs,
+		unsigned int nb, size_t samples_count, bool is_float);
+
+
+/** @brief Start the asynchronous transfers of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param nb_blocks The number of blocks that can be in flight or held by the
+ * application at the same time
+ * @param callback A pointer to a function to call each time a transfer
+ * completes, or NULL to retrieve the completed blocks with
+ * iio_buffer_get_completion
+ * @param data A user-specified pointer that will be passed to the callback
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Each block has the size of the buffer. Transfers are done in
+ * the order they were submitted, by a thread internal to the library, while
+ * the application works on the blocks that completed. On devices that
+ * exchange samples through memory-mapped kernel blocks, the blocks are
+ * those of the kernel and no copy is made; nb_blocks should then be lower
+ * than the number of kernel buffers (see iio_device_set_kernel_buffers_count).
+ *
+ * The callback is called from the internal thread. It receives the buffer,
+ * the completed block, which belongs to the application until released
+ * with iio_buffer_release_block, and the user-specified pointer.
+ *
+ * Once started, iio_buffer_refill and iio_buffer_push cannot be used
+ * anymore with this buffer. The transfers stop when the buffer is
+ * destroyed. */
+__api int iio_buffer_start_async(struct iio_buffer *buf, unsigned int nb_blocks,
+		void (*callback)(struct iio_buffer *buf,
+			struct iio_block *block, void *d), void *data);
+
+
+/** @brief Queue a refill of a free block of an input buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned; -EBUSY if all the
+ * blocks are in flight or held by the application */
+__api int iio_buffer_submit_refill(struct iio_buffer *buf);
+
+
+/** @brief Get a free block of an output buffer, to fill it with samples
+ * @param buf A pointer to an iio_buffer structure
+ * @return On success, a pointer to an iio_block structure
+ * @return On error, NULL is returned and errno is set to the error code;
+ * EBUSY if all the blocks are in flight or held by the application
+ *
+ * <b>NOTE:</b> The block belongs to the application until it is given to
+ * iio_buffer_submit_push or iio_buffer_release_block. */
+__api struct iio_block * iio_buffer_get_block(struct iio_buffer *buf);
+
+
+/** @brief Queue a push of a block of an output buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param block A pointer to an iio_block obtained with iio_buffer_get_block
+ * @param samples_count The number of samples of the block to push
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned */
+__api int iio_buffer_submit_push(struct iio_buffer *buf,
+		struct iio_block *block, size_t samples_count);
+
+
+/** @brief Retrieve the next completed block of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param wait If True, wait for the next transfer in flight to complete
+ * @return On success, a pointer to an iio_block structure
+ * @return On error, NULL is returned and errno is set to the error code;
+ * EAGAIN if no block completed and, when waiting, no transfer is in flight
+ *
+ * <b>NOTE:</b> Blocks complete in the order in which they were submitted.
+ * The result of the transfer is given by iio_block_get_status. The block
+ * belongs to the application until released with iio_buffer_release_block. */
+__api struct iio_block * iio_buffer_get_completion(struct iio_buffer *buf,
+		bool wait);
+
+
+/** @brief Get a file descriptor that is readable when completed blocks are
+ * waiting to be retrieved
+ * @param buf A pointer to an iio_buffer structure
+ * @return On success, a file descriptor to use with poll or select
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> This is an eventfd on Linux, and a pipe elsewhere. It must
+ * not be read from: iio_buffer_get_completion does it. */
+__api int iio_buffer_get_completion_fd(const struct iio_buffer *buf);
+
+
+/** @brief Give a block back to a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param block A pointer to an iio_block structure owned by the application
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The block and its samples must not be used afterwards.
+ * Blocks can be released in any order. */
+__api int iio_buffer_release_block(struct iio_buffer *buf,
+		struct iio_block *block);
+
+
+/** @brief Take the next memory-mapped kernel block out of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @return On success, a pointer to an iio_block structure
+ * @return On error, NULL is returned and errno is set to the error code;
+ * ENOSYS if the device does not exchange samples through kernel blocks
+ *
+ * <b>NOTE:</b> For an input buffer, the block holds the next samples
+ * captured; for an output buffer, it is an empty block to fill. The block
+ * belongs to the application until given back with
+ * iio_buffer_enqueue_block, which can be done from any thread and in any
+ * order: several blocks can be held and processed in parallel, up to the
+ * number of kernel buffers (see iio_device_set_kernel_buffers_count).
+ * iio_buffer_dequeue_block must not be called from several threads at the
+ * same time, and cannot be used once iio_buffer_start_async was called. */
+__api struct iio_block * iio_buffer_dequeue_block(struct iio_buffer *buf);
+
+
+/** @brief Give a block taken with iio_buffer_dequeue_block back to the kernel
+ * @param buf A pointer to an iio_buffer structure
+ * @param block A pointer to an iio_block structure
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> An input block is filled again by the hardware; an output
+ * block is sent in its entirety, unless its size was reduced with
+ * iio_block_set_bytes_used. The block and its samples must not be used
+ * afterwards. */
+__api int iio_buffer_enqueue_block(struct iio_buffer *buf,
+		struct iio_block *block);
+
+
+/** @brief Get the start address of a block
+ * @param block A pointer to an iio_block structure
+ * @return A pointer corresponding to the start address of the block */
+__api void * iio_block_start(const struct iio_block *block);
+
+
+/** @brief Find the first sample of a channel in a block
+ * @param block A pointer to an iio_block structure
+ * @param chn A pointer to an iio_channel structure
+ * @return A pointer to the first sample found, or to the end of the block if
+ * no sample for the given channel is present in the block
+ *
+ * <b>NOTE:</b> The samples of a channel are iio_buffer_step bytes apart, as
+ * in the buffer the block belongs to. */
+__api void * iio_block_first(const struct iio_block *block,
+		const struct iio_channel *chn);
+
+
+/** @brief Get the address that follows the last sample in a block
+ * @param block A pointer to an iio_block structure
+ * @return A pointer corresponding to the address that follows the last
+ * sample present in the block */
+__api void * iio_block_end(const struct iio_block *block);
+
+
+/** @brief Set how much of an output block holds samples to send
+ * @param block A pointer to an iio_block structure
+ * @param bytes_used The number of bytes to send, a multiple of the sample
+ * size of the buffer and at most the size of the block
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Meant for the blocks of iio_buffer_dequeue_block, which are
+ * handed out with the full size of the buffer; iio_block_end then follows
+ * the last byte to send. Returns -EPERM for input buffers. */
+__api int iio_block_set_bytes_used(struct iio_block *block, size_t bytes_used);
+
+
+/** @brief Get the result of the last transfer of a block
+ * @param block A pointer to an iio_block structure
+ * @return On success, the number of bytes transferred
+ * @return On error, a negative errno code is returned */
+__api ssize_t iio_block_get_status(const struct iio_block *block);
+
+
+/** @brief Get the time at which the last transfer of a block completed
+ * @param block A pointer to an iio_block structure
+ * @return The completion time, in nanoseconds of the CLOCK_MONOTONIC clock
+ * (QueryPerformanceCounter on Windows) */
+__api uint64_t iio_block_get_timestamp(const struct iio_block *block);
+
+
+/**
+ * @enum iio_stream_overrun
+ * @brief What the refill thread of a streaming buffer does when all the
+ * blocks are filled and none was consumed
+ */
+enum iio_stream_overrun {
+	IIO_STREAM_OVERRUN_BLOCK,
+	IIO_STREAM_OVERRUN_DROP_OLDEST,
+};
+
+
+/** @brief Keep refilling an input buffer from a thread internal to the
+ * library
+ * @param buf A pointer to an iio_buffer structure
+ * @param nb_blocks The number of blocks of samples, at least two
+ * @param overrun When all the blocks are filled, either wait for the
+ * application to consume one (IIO_STREAM_OVERRUN_BLOCK), or refill the
+ * oldest one (IIO_STREAM_OVERRUN_DROP_OLDEST)
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Once started, iio_buffer_refill does not wait for the device
+ * anymore: it returns the next block filled by the thread, which is then
+ * refilling the other blocks in the meantime. This avoids leaving the
+ * device idle while the application processes the samples, with backends
+ * where each refill is a round-trip (network, USB).
+ * The thread stops when the buffer is destroyed, or when the device reports
+ * an error other than a timeout, which is then returned by
+ * iio_buffer_refill. Devices exchanging samples through memory-mapped
+ * kernel blocks already refill several blocks in the background, and
+ * return -ENOSYS. */
+__api int iio_buffer_start_streaming(struct iio_buffer *buf,
+		unsigned int nb_blocks, enum iio_stream_overrun overrun);
+
+
+/** @brief Get the number of blocks dropped by a streaming buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @return The number of blocks refilled before the application could read
+ * them, with the IIO_STREAM_OVERRUN_DROP_OLDEST policy */
+__api uint64_t iio_buffer_get_dropped_blocks(const struct iio_buffer *buf);
+
+
+/**
+ * @enum iio_consumer_policy
+ * @brief What the refill thread of a fan-out does when the queue of a
+ * consumer is full
+ */
+enum iio_consumer_policy {
+	/** @brief Wait until the consumer takes a block */
+	IIO_CONSUMER_BLOCK,
+
+	/** @brief Do not publish the new block to the consumer, and count it
+	 * as dropped */
+	IIO_CONSUMER_SKIP,
+};
+
+
+/** @brief Share the samples of an input buffer between several consumers
+ * @param buf A pointer to an iio_buffer structure
+ * @param nb_blocks The number of blocks the refill thread can fill
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * Once started, a thread refills the blocks and publishes each one to all
+ * the consumers registered with iio_buffer_add_consumer, without copying
+ * it. A block is refilled again only after every consumer it was published
+ * to released it. No samples are captured while no consumer is registered.
+ *
+ * <b>NOTE:</b> Once started, iio_buffer_refill cannot be used anymore on
+ * the buffer (-EBUSY is returned). The fan-out stops, and all the
+ * consumers are destroyed, with the buffer. On devices using memory-mapped
+ * DMA blocks, the blocks published are the kernel's blocks: nb_blocks
+ * should then be lower than the number of kernel buffers. */
+__api int iio_buffer_start_fanout(struct iio_buffer *buf,
+		unsigned int nb_blocks);
+
+
+/** @brief Register a new consumer of a fan-out
+ * @param buf A pointer to an iio_buffer structure
+ * @param max_queued The maximum number of blocks published to the consumer
+ * and not taken yet
+ * @param policy What to do when max_queued blocks are waiting
+ * @return On success, a pointer to an iio_buffer_consumer structure
+ * @return On error, NULL is returned, and errno is set to the error code
+ *
+ * <b>NOTE:</b> The consumer only receives the blocks filled after it was
+ * registered. Since the blocks queued to and held by a slow consumer
+ * cannot be refilled, nb_blocks given to iio_buffer_start_fanout should be
+ * larger than the sum of the consumers' max_queued. */
+__api struct iio_buffer_consumer * iio_buffer_add_consumer(
+		struct iio_buffer *buf, unsigned int max_queued,
+		enum iio_consumer_policy policy);
+
+
+/** @brief Unregister and destroy a consumer of a fan-out
+ * @param consumer A pointer to an iio_buffer_consumer structure
+ *
+ * <b>NOTE:</b> The blocks the consumer obtained must be released before. */
+__api void iio_buffer_remove_consumer(struct iio_buffer_consumer *consumer);
+
+
+/** @brief Take the oldest block published to a consumer
+ * @param consumer A pointer to an iio_buffer_consumer structure
+ * @param wait If set, wait until a block is published
+ * @return On success, a pointer to a read-only iio_block structure
+ * @return On error, NULL is returned, and errno is set to the error code.
+ * EAGAIN is returned if no block was published and 'wait' is not set;
+ * the error that stopped the refill thread is returned once all the
+ * blocks published before it were taken
+ *
+ * <b>NOTE:</b> The same block is shared by all the consumers: its samples
+ * must not be modified. It is accessed with iio_block_start,
+ * iio_block_first and iio_block_end, and must be given back with
+ * iio_buffer_consumer_release_block. */
+__api const struct iio_block * iio_buffer_consumer_get_block(
+		struct iio_buffer_consumer *consumer, bool wait);
+
+
+/** @brief Release a block taken by a consumer
+ * @param consumer A pointer to an iio_buffer_consumer structure
+ * @param block A pointer to an iio_block structure returned by
+ * iio_buffer_consumer_get_block for this consumer */
+__api void iio_buffer_consumer_release_block(
+		struct iio_buffer_consumer *consumer,
+		const struct iio_block *block);
+
+
+/** @brief Get the number of blocks a consumer skipped
+ * @param consumer A pointer to an iio_buffer_consumer structure
+ * @return The number of blocks not published to the consumer because its
+ * queue was full, with the IIO_CONSUMER_SKIP policy */
+__api uint64_t iio_buffer_consumer_get_dropped_blocks(
+		const struct iio_buffer_consumer *consumer);
+
+
+/** @brief Keep the samples of the last refills of an input buffer in one
+ * virtually contiguous ring
+ * @param buf A pointer to an iio_buffer structure
+ * @param nb_blocks The size of the ring, in buffers' worth of samples
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * The ring is mapped twice, the second mapping right after the first one,
+ * so that the samples wrapping around its end can be read in place. Once
+ * started, each refill appends its samples to the ring, and
+ * iio_buffer_start, iio_buffer_first and iio_buffer_end point into it.
+ * Windows spanning several refills are then obtained with
+ * iio_buffer_ring_window, without copying the samples.
+ *
+ * <b>NOTE:</b> The size of the ring is rounded up to a whole number of
+ * pages. On devices using memory-mapped DMA blocks, each block is copied
+ * once into the ring; other backends read straight into it. The ring
+ * cannot be combined with the asynchronous API, the streaming mode or the
+ * fan-out, and it is released with the buffer. This function returns
+ * -ENOSYS on Windows. */
+__api int iio_buffer_start_ring(struct iio_buffer *buf,
+		unsigned int nb_blocks);
+
+
+/** @brief Get the latest samples of a ring as one contiguous window
+ * @param buf A pointer to an iio_buffer structure
+ * @param nb_samples The number of samples of the window
+ * @return On success, a pointer to the first of the last nb_samples
+ * samples refilled
+ * @return On error, NULL is returned, and errno is set to the error code
+ *
+ * <b>NOTE:</b> The window ends where iio_buffer_end does; the samples are
+ * laid out as in the buffer, so that the first sample of a channel is at
+ * the same offset from the window as iio_buffer_first is from
+ * iio_buffer_start. The window is valid until the next refill, and
+ * nb_samples cannot exceed iio_buffer_ring_get_samples_count. */
+__api void * iio_buffer_ring_window(const struct iio_buffer *buf,
+		size_t nb_samples);
+
+
+/** @brief Get the number of samples a ring currently holds
+ * @param buf A pointer to an iio_buffer structure
+ * @return The number of samples available to iio_buffer_ring_window, or 0
+ * if iio_buffer_start_ring was not called */
+__api size_t iio_buffer_ring_get_samples_count(const struct iio_buffer *buf);
+
+
+/** @brief Decimate the samples of a channel with a FIR filter on each
+ * refill
+ * @param buf A pointer to an iio_buffer structure
+ * @param chn A pointer to an iio_channel structure of the buffer's device
+ * @param factor The decimation factor: one output is produced every
+ * 'factor' input samples
+ * @param taps The coefficients of the filter, applied to the samples after
+ * conversion to the CPU format (see iio_channel_convert)
+ * @param nb_taps The number of coefficients
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * The filter runs right after iio_buffer_refill and iio_buffer_refill_min,
+ * on the raw samples of the buffer, and keeps its state from one refill to
+ * the next. iio_channel_read then returns the decimated samples rounded and
+ * saturated to the range of the channel, and iio_channel_read_float and
+ * iio_channel_read_double return them scaled, without rounding.
+ *
+ * <b>NOTE:</b> The functions accessing the buffer directly, such as
+ * iio_buffer_first, iio_channel_read_raw or iio_buffer_deinterleave, still
+ * see the samples at the full rate. Channels with a repeat count above one
+ * are not supported (-EINVAL), and neither are sample sizes other than 8,
+ * 16, 32 or 64 bits (-ENOSYS). The samples of the blocks of the
+ * asynchronous API and of the fan-out are not filtered. */
+__api int iio_buffer_add_decimator(struct iio_buffer *buf,
+		const struct iio_channel *chn, unsigned int factor,
+		const float *taps, size_t nb_taps);
+
+
+/** @brief Stop decimating the samples of a channel
+ * @param buf A pointer to an iio_buffer structure
+ * @param chn A pointer to an iio_channel structure
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned; -ENOENT if no
+ * decimator was added for the channel */
+__api int iio_buffer_remove_decimator(struct iio_buffer *buf,
+		const struct iio_channel *chn);
+
+
+/**
+ * @enum iio_trigger_mode
+ * @brief Condition on the samples of a channel that fires a capture
+ */
+enum iio_trigger_mode {
+	/** @brief The sample crosses the threshold upwards */
+	IIO_TRIGGER_RISING,
+
+	/** @brief The sample crosses the threshold downwards */
+	IIO_TRIGGER_FALLING,
+
+	/** @brief The sample crosses the threshold either way */
+	IIO_TRIGGER_EDGE,
+
+	/** @brief The sample is at or above the threshold */
+	IIO_TRIGGER_HIGH,
+
+	/** @brief The sample is below the threshold */
+	IIO_TRIGGER_LOW,
+};
+
+
+/** @brief Capture windows of samples around a trigger condition
+ * @param buf A pointer to an iio_buffer structure
+ * @param chn A pointer to the enabled iio_channel structure to watch
+ * @param mode The trigger condition
+ * @param threshold The threshold, in the units of the samples converted
+ * with iio_channel_convert
+ * @param pre_samples The number of samples before the trigger to capture
+ * @param post_samples The number of samples to capture from the trigger,
+ * which is the first of them
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * The buffer is switched to ring mode (see iio_buffer_start_ring), with a
+ * ring large enough for one window and one refill, unless the ring was
+ * already started; -ENOSPC is then returned if it is too small. Windows
+ * are then obtained with iio_buffer_capture.
+ *
+ * <b>NOTE:</b> The samples are compared as single-precision floats, which
+ * cannot represent all the values of channels over 24 bits. The trigger is
+ * armed once pre_samples samples were captured, and again at the end of
+ * each window. The capture stops with the buffer. */
+__api int iio_buffer_start_capture(struct iio_buffer *buf,
+		const struct iio_channel *chn, enum iio_trigger_mode mode,
+		double threshold, size_t pre_samples, size_t post_samples);
+
+
+/** @brief Refill a buffer until the trigger fires and the window is
+ * complete
+ * @param buf A pointer to an iio_buffer structure
+ * @param start A pointer to a variable set to the first sample of the
+ * window
+ * @return On success, the size of the window in bytes
+ * @return On error, a negative errno code is returned; an error of
+ * iio_buffer_refill (e.g. -EAGAIN in non-blocking mode) does not lose the
+ * progress of the capture, and the function can be called again
+ *
+ * <b>NOTE:</b> The window holds all the enabled channels, laid out as in
+ * the buffer (see iio_buffer_ring_window), and stays valid until the next
+ * refill. Samples refilled by the application between two calls are
+ * scanned too, unless they were already overwritten. */
+__api ssize_t iio_buffer_capture(struct iio_buffer *buf, void **start);
+
+
+/**
+ * @struct iio_channel_stats
+ * @brief Summary of the samples of one channel
+ *
+ * The values are those of the samples converted with iio_channel_convert,
+ * sign-extended for signed channels. */
+struct iio_channel_stats {
+	/** @brief Number of values; a sample of a channel with a repeat
+	 * count above one holds several of them */
+	uint64_t count;
+
+	/** @brief Smallest and largest values, or 0 if count is 0 */
+	int64_t min, max;
+
+	/** @brief Sum of the values */
+	int64_t sum;
+
+	/** @brief Sum of the squares of the values */
+	double sum_squares;
+
+	/** @brief Number of values at the lowest or highest value the
+	 * channel's number of bits can represent */
+	uint64_t clipped;
+};
+
+
+/** @brief Compute the statistics of channels over the samples of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param chns An array of pointers to iio_channel structures
+ * @param nb_channels The number of channels in the array
+ * @param stats An array of nb_channels iio_channel_stats structures, filled
+ * with the statistics of the corresponding channel
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> The samples are read in place, in one pass over the buffer
+ * for all the channels. Channels which are not enabled get a count of 0.
+ * Only sample sizes of 8, 16, 32 and 64 bits are supported (-ENOSYS). */
+__api int iio_buffer_compute_stats(const struct iio_buffer *buf,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats);
+
+
+/** @brief Compute the statistics of channels over the first samples of a
+ * buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param chns An array of pointers to iio_channel structures
+ * @param nb_channels The number of channels in the array
+ * @param stats An array of nb_channels iio_channel_stats structures, filled
+ * with the statistics of the corresponding channel
+ * @param samples_count The maximum number of samples to go through
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> Same as iio_buffer_compute_stats, over at most samples_count
+ * samples of the buffer. */
+__api int iio_buffer_compute_stats_partial(const struct iio_buffer *buf,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats, size_t samples_count);
+
+
+/** @brief Refill a buffer, and compute the statistics of channels over the
+ * new samples
+ * @param buf A pointer to an iio_buffer structure
+ * @param chns An array of pointers to iio_channel structures
+ * @param nb_channels The number of channels in the array
+ * @param stats An array of nb_channels iio_channel_stats structures, filled
+ * with the statistics of the corresponding channel
+ * @return On success, the number of bytes refilled is returned
+ * @return On error, a negative errno code is returned
+ *
+ * <b>NOTE:</b> With the network backend, the statistics are computed by
+ * the server, and only they are transferred: the buffer is then left
+ * empty. With the other backends, or servers older than 0.12, this is the
+ * same as iio_buffer_refill followed by iio_buffer_compute_stats. */
+__api ssize_t iio_buffer_refill_stats(struct iio_buffer *buf,
+		const struct iio_channel * const *chns, unsigned int nb_channels,
+		struct iio_channel_stats *stats);
+
+
+/** @brief Number of buckets of the latency histograms of iio_buffer_stats */
+#define IIO_BUFFER_STATS_BUCKETS 32
+
+
+/**
+ * @struct iio_buffer_stats
+ * @brief Performance counters of a buffer
+ *
+ * The latency histograms are log2-bucketed: bucket 0 counts the operations
+ * which completed in less than one microsecond, and bucket N (N > 0) the ones
+ * which took between 2^(N-1) and 2^N microseconds. The last bucket also
+ * counts everything slower. */
+struct iio_buffer_stats {
+	/** @brief Number of bytes transferred */
+	uint64_t bytes;
+
+	/** @brief Number of successful refill or push operations */
+	uint64_t blocks;
+
+	/** @brief Number of operations which returned -ETIMEDOUT */
+	uint64_t timeouts;
+
+	/** @brief Number of operations which returned -EAGAIN */
+	uint64_t eagain;
+
+	/** @brief Number of operations which failed with any other error */
+	uint64_t errors;
+
+	/** @brief Number of calls to iio_buffer_cancel() */
+	uint64_t cancellations;
+
+	/** @brief Number of times the kernel was left without any block to
+	 * transfer to or from (local high-speed buffers only) */
+	uint64_t queue_empty;
+
+	/** @brief Number of blocks dropped by a streaming buffer */
+	uint64_t dropped;
+
+	/** @brief Longest time spent by the application between the end of a
+	 * refill and the start of the next one, in nanoseconds */
+	uint64_t max_refill_gap_ns;
+
+	/** @brief Histogram of the refill latencies */
+	uint64_t refill_latency[IIO_BUFFER_STATS_BUCKETS];
+
+	/** @brief Histogram of the push latencies */
+	uint64_t push_latency[IIO_BUFFER_STATS_BUCKETS];
+};
+
+
+/** @brief Retrieve the performance counters of a buffer
+ * @param buf A pointer to an iio_buffer structure
+ * @param stats A pointer to an iio_buffer_stats structure, filled with the
+ * counters accumulated since the buffer was created or since the last call
+ * to iio_buffer_reset_stats
+ *
+ * <b>NOTE:</b> The counters are updated one by one by the thread performing
+ * the transfers: when used with iio_buffer_start_async,
+ * a snapshot taken while blocks are in flight may be slightly out of date. */
+__api void iio_buffer_get_stats(const struct iio_buffer *buf,
+		struct iio_buffer_stats *stats);
+
+
+/** @brief Reset the performance counters of a buffer
+ * @param buf A pointer to an iio_buffer structure */
+__api void iio_buffer_reset_stats(struct iio_buffer *buf);
+
+
+/** @brief Get the time at which the samples of a buffer were received
+ * @param buf A pointer to an iio_buffer structure
+ * @return The completion time of the last successful refill, in nanoseconds
+ * of the CLOCK_MONOTONIC clock (QueryPerformanceCounter on Windows), or 0 if
+ * the buffer was never refilled
+ *
+ * <b>NOTE:</b> For streaming buffers, this is the time at which the refill
+ * thread completed the block, not the time iio_buffer_refill returned it. */
+__api uint64_t iio_buffer_get_timestamp(const struct iio_buffer *buf);
+
+
+/** @brief Get the latencies reported by the server for the last refill
+ * @param buf A pointer to an iio_buffer structure
+ * @param server_ns If not NULL, will be set to the time the samples spent on
+ * the server between their capture and their transmission, in nanoseconds
+ * @param transport_ns If not NULL, will be set to the time spent receiving
+ * the samples, in nanoseconds
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned. -ENOSYS is returned
+ * for local contexts, and when the server is too old to report its latency
+ *
+ * <b>NOTE:</b> The server only reports a latency with a microsecond
+ * resolution. */
+__api int iio_buffer_get_remote_latency(const struct iio_buffer *buf,
+		uint64_t *server_ns, uint64_t *transport_ns);
+
+
+/** @brief Extract the hardware timestamps of the first and last samples
+ * @param buf A pointer to an iio_buffer structure
+ * @param first If not NULL, will be set to the value of the timestamp channel
+ * in the first sample of the buffer
+ * @param last If not NULL, will be set to the value of the timestamp channel
+ * in the last sample of the buffer
+ * @return On success, 0 is returned
+ * @return On error, a negative errno code is returned. -ENOENT is returned if
+ * the device has no IIO_TIMESTAMP channel, or if it is not enabled
+ *
+ * <b>NOTE:</b> The timestamp channel is located once, when the buffer is
+ * created: this function only performs two conversions. */
+__api int iio_buffer_get_sample_timestamps(const struct iio_buffer *buf,
+		int64_t *first, int64_t *last);
+
+
 /** @brief Associate a pointer to an iio_buffer structure
  * @param buf A pointer to an iio_buffer structure
  * @param data The pointer to be associated */
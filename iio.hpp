@@ -0,0 +1,564 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+/** @file iio.hpp
+ * @brief Header-only C++11 wrapper of the public API of libiio
+ *
+ * The contexts and buffers are owned by move-only RAII classes; devices and
+ * channels are lightweight views, valid as long as their context is.
+ * Errors are reported by throwing iio::error.
+ *
+ * The samples of a channel are read through iio::channel_view, templated on
+ * the storage type and the format of the samples, so that the conversion is
+ * resolved at compile time. iio::make_channel_view checks the template
+ * arguments against the format of the channel, and iio::visit_channel picks
+ * the instantiation matching the format at runtime. */
+
+#ifndef __IIO_HPP__
+#define __IIO_HPP__
+
+#include <iio.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace iio {
+
+/** @brief Exception thrown when a function of libiio fails */
+class error : public std::system_error {
+public:
+	/** @brief Build from the negative error code returned by libiio */
+	error(int err, const char *what) :
+		std::system_error(err < 0 ? -err : err,
+				std::generic_category(), what) {}
+};
+
+namespace detail {
+
+inline void check(int ret, const char *what)
+{
+	if (ret < 0)
+		throw error(ret, what);
+}
+
+template <typename T> inline T * check_ptr(T *ptr, const char *what)
+{
+	if (!ptr)
+		throw error(errno ? errno : EIO, what);
+	return ptr;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool host_is_be = true;
+#else
+constexpr bool host_is_be = false;
+#endif
+
+/* Portable byte swap; GCC, Clang and MSVC turn it into one instruction */
+template <typename U> inline U bswap(U v)
+{
+	U ret = 0;
+
+	for (unsigned int i = 0; i < sizeof(U); i++) {
+		ret = (U) ((ret << 8) | (v & 0xff));
+		v = (U) (v >> 8);
+	}
+
+	return ret;
+}
+
+} /* namespace detail */
+
+class channel;
+
+/** @brief View of an iio_device, valid as long as its context */
+class device {
+public:
+	explicit device(iio_device *dev) : dev_(dev) {}
+
+	iio_device * get() const { return dev_; }
+
+	const char * id() const { return iio_device_get_id(dev_); }
+	const char * name() const { return iio_device_get_name(dev_); }
+
+	unsigned int channels_count() const
+	{
+		return iio_device_get_channels_count(dev_);
+	}
+
+	channel get_channel(unsigned int index) const;
+	channel find_channel(const std::string &name, bool output) const;
+
+private:
+	iio_device *dev_;
+};
+
+/** @brief View of an iio_channel, valid as long as its context */
+class channel {
+public:
+	explicit channel(iio_channel *chn) : chn_(chn) {}
+
+	iio_channel * get() const { return chn_; }
+
+	const char * id() const { return iio_channel_get_id(chn_); }
+	const char * name() const { return iio_channel_get_name(chn_); }
+	bool is_output() const { return iio_channel_is_output(chn_); }
+	bool is_scan_element() const
+	{
+		return iio_channel_is_scan_element(chn_);
+	}
+
+	void enable() const { iio_channel_enable(chn_); }
+	void disable() const { iio_channel_disable(chn_); }
+	bool is_enabled() const { return iio_channel_is_enabled(chn_); }
+
+	const iio_data_format & format() const
+	{
+		return *iio_channel_get_data_format(chn_);
+	}
+
+private:
+	iio_channel *chn_;
+};
+
+inline channel device::get_channel(unsigned int index) const
+{
+	return channel(detail::check_ptr(iio_device_get_channel(dev_, index),
+				"iio_device_get_channel"));
+}
+
+inline channel device::find_channel(const std::string &name, bool output) const
+{
+	errno = ENOENT;
+	return channel(detail::check_ptr(iio_device_find_channel(dev_,
+					name.c_str(), output),
+				"iio_device_find_channel"));
+}
+
+/** @brief Owner of an iio_context */
+class context {
+public:
+	/** @brief Take the ownership of a context */
+	explicit context(iio_context *ctx) :
+		ctx_(detail::check_ptr(ctx, "iio_create_context")) {}
+
+	/** @brief Create a context from a URI, e.g. "ip:192.168.2.1" */
+	explicit context(const std::string &uri) :
+		ctx_(detail::check_ptr(iio_create_context_from_uri(uri.c_str()),
+					"iio_create_context_from_uri")) {}
+
+	context(const context &) = delete;
+	context & operator=(const context &) = delete;
+
+	context(context &&other) noexcept : ctx_(other.ctx_)
+	{
+		other.ctx_ = nullptr;
+	}
+
+	context & operator=(context &&other) noexcept
+	{
+		std::swap(ctx_, other.ctx_);
+		return *this;
+	}
+
+	~context()
+	{
+		if (ctx_)
+			iio_context_destroy(ctx_);
+	}
+
+	/** @brief Create the default context */
+	static context create_default()
+	{
+		return context(iio_create_default_context());
+	}
+
+	iio_context * get() const { return ctx_; }
+
+	const char * name() const { return iio_context_get_name(ctx_); }
+
+	unsigned int devices_count() const
+	{
+		return iio_context_get_devices_count(ctx_);
+	}
+
+	device get_device(unsigned int index) const
+	{
+		return device(detail::check_ptr(
+					iio_context_get_device(ctx_, index),
+					"iio_context_get_device"));
+	}
+
+	device find_device(const std::string &name) const
+	{
+		errno = ENODEV;
+		return device(detail::check_ptr(
+					iio_context_find_device(ctx_,
+						name.c_str()),
+					"iio_context_find_device"));
+	}
+
+	void set_timeout(unsigned int timeout_ms) const
+	{
+		detail::check(iio_context_set_timeout(ctx_, timeout_ms),
+				"iio_context_set_timeout");
+	}
+
+private:
+	iio_context *ctx_;
+};
+
+/** @brief Owner of an iio_buffer */
+class buffer {
+public:
+	/** @brief Create a buffer for the enabled channels of a device */
+	buffer(const device &dev, std::size_t samples_count,
+			bool cyclic = false) :
+		buf_(detail::check_ptr(iio_device_create_buffer(dev.get(),
+					samples_count, cyclic),
+				"iio_device_create_buffer")) {}
+
+	buffer(const buffer &) = delete;
+	buffer & operator=(const buffer &) = delete;
+
+	buffer(buffer &&other) noexcept : buf_(other.buf_)
+	{
+		other.buf_ = nullptr;
+	}
+
+	buffer & operator=(buffer &&other) noexcept
+	{
+		std::swap(buf_, other.buf_);
+		return *this;
+	}
+
+	~buffer()
+	{
+		if (buf_)
+			iio_buffer_destroy(buf_);
+	}
+
+	iio_buffer * get() const { return buf_; }
+
+	/** @brief Fetch more samples; returns the number of bytes read */
+	std::size_t refill()
+	{
+		ssize_t ret = iio_buffer_refill(buf_);
+
+		if (ret < 0)
+			throw error((int) ret, "iio_buffer_refill");
+		return (std::size_t) ret;
+	}
+
+	/** @brief Send the samples; returns the number of bytes written */
+	std::size_t push()
+	{
+		ssize_t ret = iio_buffer_push(buf_);
+
+		if (ret < 0)
+			throw error((int) ret, "iio_buffer_push");
+		return (std::size_t) ret;
+	}
+
+	void set_blocking_mode(bool blocking)
+	{
+		detail::check(iio_buffer_set_blocking_mode(buf_, blocking),
+				"iio_buffer_set_blocking_mode");
+	}
+
+	void cancel() { iio_buffer_cancel(buf_); }
+
+	void * start() const { return iio_buffer_start(buf_); }
+	void * end() const { return iio_buffer_end(buf_); }
+	std::ptrdiff_t step() const { return iio_buffer_step(buf_); }
+
+	void * first(const channel &chn) const
+	{
+		return iio_buffer_first(buf_, chn.get());
+	}
+
+private:
+	iio_buffer *buf_;
+};
+
+/** @brief Byte order of the samples, as a template argument */
+struct little_endian {
+	static constexpr bool is_be = false;
+};
+
+/** @brief Byte order of the samples, as a template argument */
+struct big_endian {
+	static constexpr bool is_be = true;
+};
+
+/** @brief Value of the Bits and Shift template arguments of channel_view
+ * meaning that they are only known at runtime */
+constexpr unsigned int dynamic = ~0u;
+
+/** @brief Typed view of the samples of one channel in a buffer
+ *
+ * @tparam T The storage type of one sample: its size must be the length of
+ * the samples, and its signedness their sign
+ * @tparam Endian little_endian or big_endian
+ * @tparam Bits Number of valid bits, or iio::dynamic
+ * @tparam Shift Right-shift to apply to the samples, or iio::dynamic
+ *
+ * Iterating over the view yields the converted samples, with the semantics
+ * of iio_channel_convert: the bytes are swapped if needed, shifted right,
+ * then sign-extended (or masked) to 'Bits' bits. Only the first value of
+ * channels with a repeat count above 1 is returned.
+ *
+ * The view holds raw pointers: it is invalidated by the next refill. */
+template <typename T, typename Endian = little_endian,
+	 unsigned int Bits = 8 * sizeof(T), unsigned int Shift = 0>
+class channel_view {
+	static_assert(std::is_integral<T>::value && sizeof(T) <= 8,
+			"T must be an integer type of at most 64 bits");
+
+	typedef typename std::make_unsigned<T>::type U;
+
+	static constexpr unsigned int length = 8 * sizeof(T);
+
+public:
+	typedef T value_type;
+
+	class iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T *pointer;
+		typedef T reference;
+
+		iterator(const channel_view *view, const char *ptr) :
+			view_(view), ptr_(ptr) {}
+
+		T operator*() const { return view_->load(ptr_); }
+
+		iterator & operator++()
+		{
+			ptr_ += view_->step_;
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator tmp = *this;
+			ptr_ += view_->step_;
+			return tmp;
+		}
+
+		bool operator==(const iterator &other) const
+		{
+			return ptr_ == other.ptr_;
+		}
+
+		bool operator!=(const iterator &other) const
+		{
+			return ptr_ != other.ptr_;
+		}
+
+	private:
+		const channel_view *view_;
+		const char *ptr_;
+	};
+
+	/** @brief Build a view without checking the channel's format; prefer
+	 * iio::make_channel_view */
+	channel_view(const buffer &buf, const channel &chn,
+			unsigned int bits = Bits, unsigned int shift = Shift) :
+		first_(static_cast<const char *>(buf.first(chn))),
+		end_(static_cast<const char *>(buf.end())),
+		step_(buf.step()), bits_(bits), shift_(shift) {}
+
+	iterator begin() const { return iterator(this, first_); }
+
+	iterator end() const
+	{
+		return iterator(this, first_ + size() * step_);
+	}
+
+	std::size_t size() const
+	{
+		return first_ < end_ ?
+			(std::size_t) ((end_ - first_ + step_ - 1) / step_) : 0;
+	}
+
+	T operator[](std::size_t index) const
+	{
+		return load(first_ + index * step_);
+	}
+
+	/** @brief Convert one raw sample, as stored in the buffer */
+	T convert(U raw) const
+	{
+		unsigned int bits = Bits == dynamic ? bits_ : Bits;
+		unsigned int shift = Shift == dynamic ? shift_ : Shift;
+
+		if (sizeof(T) > 1 && Endian::is_be != detail::host_is_be)
+			raw = detail::bswap(raw);
+
+		if (shift)
+			raw = (U) (raw >> shift);
+
+		if (bits < length) {
+			U mask = (U) (((U) 1 << bits) - 1);
+
+			raw &= mask;
+			if (std::is_signed<T>::value &&
+					(raw & ((U) 1 << (bits - 1))))
+				raw |= (U) ~mask;
+		}
+
+		return (T) raw;
+	}
+
+	/** @brief Check that the view matches a data format; the repeat
+	 * count is not checked, as only the first value is read */
+	bool matches(const iio_data_format &fmt) const
+	{
+		return fmt.length == length &&
+			fmt.is_be == Endian::is_be &&
+			fmt.is_signed == std::is_signed<T>::value &&
+			fmt.bits == (Bits == dynamic ? bits_ : Bits) &&
+			fmt.shift == (Shift == dynamic ? shift_ : Shift);
+	}
+
+private:
+	T load(const char *ptr) const
+	{
+		U raw;
+
+		std::memcpy(&raw, ptr, sizeof(raw));
+		return convert(raw);
+	}
+
+	const char *first_, *end_;
+	std::ptrdiff_t step_;
+	unsigned int bits_, shift_;
+};
+
+/** @brief Build a typed view of a channel, checking its format
+ *
+ * Throws iio::error with EINVAL if the format of the channel does not match
+ * the template arguments, and ENOENT if the channel is not in the buffer.
+ * As with iio::visit_channel, a channel with a repeat count above 1 is
+ * accepted, and the view yields the first value of each sample. */
+template <typename T, typename Endian = little_endian,
+	 unsigned int Bits = 8 * sizeof(T), unsigned int Shift = 0>
+channel_view<T, Endian, Bits, Shift> make_channel_view(const buffer &buf,
+		const channel &chn)
+{
+	const iio_data_format &fmt = chn.format();
+	channel_view<T, Endian, Bits, Shift> view(buf, chn,
+			fmt.bits, fmt.shift);
+
+	if (!view.matches(fmt))
+		throw error(EINVAL, "make_channel_view");
+	if (!chn.is_enabled())
+		throw error(ENOENT, "make_channel_view");
+
+	return view;
+}
+
+namespace detail {
+
+template <typename T, typename Endian, typename F>
+void visit_view(const buffer &buf, const channel &chn, F &&f)
+{
+	const iio_data_format &fmt = chn.format();
+
+	/* The common "full width, no shift" case gets its own instantiation */
+	if (fmt.bits == 8 * sizeof(T) && !fmt.shift)
+		f(channel_view<T, Endian>(buf, chn));
+	else
+		f(channel_view<T, Endian, dynamic, dynamic>(buf, chn,
+					fmt.bits, fmt.shift));
+}
+
+template <typename Endian, typename F>
+void visit_length(const buffer &buf, const channel &chn, F &&f)
+{
+	const iio_data_format &fmt = chn.format();
+
+	switch (fmt.length) {
+	case 8:
+		if (fmt.is_signed)
+			visit_view<std::int8_t, Endian>(buf, chn, f);
+		else
+			visit_view<std::uint8_t, Endian>(buf, chn, f);
+		break;
+	case 16:
+		if (fmt.is_signed)
+			visit_view<std::int16_t, Endian>(buf, chn, f);
+		else
+			visit_view<std::uint16_t, Endian>(buf, chn, f);
+		break;
+	case 32:
+		if (fmt.is_signed)
+			visit_view<std::int32_t, Endian>(buf, chn, f);
+		else
+			visit_view<std::uint32_t, Endian>(buf, chn, f);
+		break;
+	case 64:
+		if (fmt.is_signed)
+			visit_view<std::int64_t, Endian>(buf, chn, f);
+		else
+			visit_view<std::uint64_t, Endian>(buf, chn, f);
+		break;
+	default:
+		throw error(ENOTSUP, "visit_channel");
+	}
+}
+
+} /* namespace detail */
+
+/** @brief Call a function with the channel_view matching a channel's format
+ *
+ * @param buf The buffer containing the samples
+ * @param chn The channel to read
+ * @param f A callable accepting any channel_view, typically a generic
+ * lambda: it is instantiated once per supported format, and the loops it
+ * contains get the conversion inlined
+ *
+ * Throws iio::error with ENOTSUP for lengths other than 8, 16, 32 or 64
+ * bits, and ENOENT if the channel is not in the buffer. The views of
+ * channels with a repeat count above 1 yield the first value of each
+ * sample. */
+template <typename F>
+void visit_channel(const buffer &buf, const channel &chn, F &&f)
+{
+	if (!chn.is_enabled())
+		throw error(ENOENT, "visit_channel");
+
+	if (chn.format().is_be)
+		detail::visit_length<big_endian>(buf, chn, f);
+	else
+		detail::visit_length<little_endian>(buf, chn, f);
+}
+
+} /* namespace iio */
+
+#endif /* __IIO_HPP__ */
@@ -30,6 +30,10 @@ struct iiod_client {
 	struct iio_context_pdata *pdata;
 	const struct iiod_client_ops *ops;
 	struct iio_mutex *lock;
+
+	/* Set when the server understands the TIMESTAMPS, STATS and PARTIAL
+	 * keywords of READBUF, as decided from its version */
+	bool readbuf_keywords;
 };
 
 static ssize_t iiod_client_read_integer(struct iiod_client *client,
@@ -148,6 +152,7 @@ struct iiod_client * iiod_client_new(struct iio_context_pdata *pdata,
 	client->lock = lock;
 	client->pdata = pdata;
 	client->ops = ops;
+	client->readbuf_keywords = false;
 	return client;
 }
 
@@ -453,10 +458,18 @@ struct iio_context * iiod_client_create_context(
 		struct iiod_client *client, void *desc)
 {
 	struct iio_context *ctx = NULL;
+	unsigned int major, minor;
 	size_t xml_len;
 	char *xml;
 	int ret;
 
+	ret = iiod_client_get_version(client, desc, &major, &minor, NULL);
+	if (ret < 0)
+		goto out_set_errno;
+
+	/* The extended READBUF appeared with the 0.12 servers */
+	client->readbuf_keywords = major > 0 || minor >= 12;
+
 	iio_mutex_lock(client->lock);
 	ret = iiod_client_exec_command(client, desc, "PRINT\r\n");
 	if (ret < 0)
@@ -482,6 +495,7 @@ out_free_xml:
 	free(xml);
 out_unlock:
 	iio_mutex_unlock(client->lock);
+out_set_errno:
 	if (!ctx)
 		errno = -ret;
 	return ctx;
@@ -550,20 +564,27 @@ out_buf_free:
 	return (int) ret;
 }
 
-ssize_t iiod_client_read_unlocked(struct iiod_client *client, void *desc,
+static ssize_t iiod_client_readbuf(struct iiod_client *client, void *desc,
 		const struct iio_device *dev, void *dst, size_t len,
-		uint32_t *mask, size_t words)
+		uint32_t *mask, size_t words, bool partial)
 {
 	unsigned int nb_channels = iio_device_get_channels_count(dev);
 	uintptr_t ptr = (uintptr_t) dst;
+	uint64_t first_ns = 0;
+	int server_us = -1;
 	char buf[1024];
 	ssize_t ret, read = 0;
+	bool timestamps;
 
 	if (!len || words != (nb_channels + 31) / 32)
 		return -EINVAL;
 
-	iio_snprintf(buf, sizeof(buf), "READBUF %s %lu\r\n",
-			iio_device_get_id(dev), (unsigned long) len);
+	timestamps = client->readbuf_keywords;
+	partial = partial && client->readbuf_keywords;
+	iio_snprintf(buf, sizeof(buf), "READBUF %s %lu%s%s\r\n",
+			iio_device_get_id(dev), (unsigned long) len,
+			partial ? " PARTIAL" : "",
+			timestamps ? " TIMESTAMPS" : "");
 
 	ret = iiod_client_write_all(client, desc, buf, strlen(buf));
 	if (ret < 0)
@@ -575,11 +596,26 @@ ssize_t iiod_client_read_unlocked(struct iiod_client *client, void *desc,
 		ret = iiod_client_read_integer(client, desc, &to_read);
 		if (ret < 0)
 			return ret;
+
 		if (to_read < 0)
 			return (ssize_t) to_read;
 		if (!to_read)
 			break;
 
+		if (timestamps) {
+			int age_us;
+
+			ret = iiod_client_read_integer(client, desc, &age_us);
+			if (ret < 0)
+				return ret;
+
+			/* The first chunk holds the oldest samples */
+			if (server_us < 0) {
+				server_us = age_us;
+				first_ns = iio_time_ns();
+			}
+		}
+
 		if (mask) {
 			ret = iiod_client_read_mask(client, desc, mask, words);
 			if (ret < 0)
@@ -597,6 +633,129 @@ ssize_t iiod_client_read_unlocked(struct iiod_client *client, void *desc,
 		len -= ret;
 	} while (len);
 
+	if (dev->buffer && server_us >= 0) {
+		dev->buffer->server_latency_ns = (uint64_t) server_us * 1000;
+		dev->buffer->transport_latency_ns = iio_time_ns() - first_ns;
+		dev->buffer->has_remote_latency = true;
+	}
+
+	return read;
+}
+
+ssize_t iiod_client_read_unlocked(struct iiod_client *client, void *desc,
+		const struct iio_device *dev, void *dst, size_t len,
+		uint32_t *mask, size_t words)
+{
+	return iiod_client_readbuf(client, desc, dev, dst, len,
+			mask, words, false);
+}
+
+/* The server refills its own buffer only until it holds 'len' bytes,
+ * instead of waiting for it to be full */
+ssize_t iiod_client_read_partial_unlocked(struct iiod_client *client,
+		void *desc, const struct iio_device *dev, void *dst, size_t len,
+		uint32_t *mask, size_t words)
+{
+	return iiod_client_readbuf(client, desc, dev, dst, len,
+			mask, words, true);
+}
+
+/* Each line is "<count> <min> <max> <sum> <sum_squares> <clipped>" */
+static int iiod_client_read_stats(struct iiod_client *client, void *desc,
+		struct iio_channel_stats *stats)
+{
+	struct iio_channel_stats chunk;
+	char buf[1024], *ptr, *end;
+	ssize_t ret;
+
+	ret = client->ops->read_line(client->pdata, desc, buf, sizeof(buf) - 1);
+	if (ret < 0)
+		return (int) ret;
+
+	buf[ret] = '\0';
+	ptr = buf;
+
+	chunk.count = strtoull(ptr, &end, 10);
+	if (ptr == end)
+		return -EINVAL;
+	chunk.min = strtoll(end, &end, 10);
+	chunk.max = strtoll(end, &end, 10);
+	chunk.sum = strtoll(end, &end, 10);
+	chunk.sum_squares = strtod(end, &end);
+	chunk.clipped = strtoull(end, &end, 10);
+
+	if (!chunk.count)
+		return 0;
+
+	/* Merge with the previous chunks */
+	if (!stats->count || chunk.min < stats->min)
+		stats->min = chunk.min;
+	if (!stats->count || chunk.max > stats->max)
+		stats->max = chunk.max;
+	stats->count += chunk.count;
+	stats->sum += chunk.sum;
+	stats->sum_squares += chunk.sum_squares;
+	stats->clipped += chunk.clipped;
+	return 0;
+}
+
+ssize_t iiod_client_read_stats_unlocked(struct iiod_client *client,
+		void *desc, const struct iio_device *dev, size_t len,
+		uint32_t *mask, size_t words, struct iio_channel_stats *stats)
+{
+	unsigned int i, nb_channels = iio_device_get_channels_count(dev);
+	bool has_mask = false;
+	char buf[1024];
+	ssize_t ret, read = 0;
+
+	if (!len || !mask || words != (nb_channels + 31) / 32)
+		return -EINVAL;
+	if (!client->readbuf_keywords)
+		return -ENOSYS;
+
+	iio_snprintf(buf, sizeof(buf), "READBUF %s %lu STATS\r\n",
+			iio_device_get_id(dev), (unsigned long) len);
+
+	ret = iiod_client_write_all(client, desc, buf, strlen(buf));
+	if (ret < 0)
+		return ret;
+
+	memset(stats, 0, nb_channels * sizeof(*stats));
+
+	do {
+		int to_read;
+
+		ret = iiod_client_read_integer(client, desc, &to_read);
+		if (ret < 0)
+			return ret;
+
+		if (to_read < 0)
+			return (ssize_t) to_read;
+		if (!to_read)
+			break;
+
+		if (!has_mask) {
+			ret = iiod_client_read_mask(client, desc, mask, words);
+			if (ret < 0)
+				return ret;
+
+			has_mask = true;
+		}
+
+		/* One line per channel of the mask, instead of the samples */
+		for (i = 0; i < nb_channels; i++) {
+			if (!TEST_BIT(mask, i))
+				continue;
+
+			ret = iiod_client_read_stats(client, desc, &stats[i]);
+			if (ret < 0)
+				return ret;
+		}
+
+		read += to_read;
+		len -= to_read;
+	} while (len);
+
 	return read;
 }
 
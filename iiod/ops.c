@@ -23,6 +23,7 @@
 #include "../iio-private.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
 #include <poll.h>
@@ -51,7 +52,8 @@ struct ThdEntry {
 	struct DevEntry *entry;
 
 	uint32_t *mask;
-	bool active, is_writer, new_client, wait_for_open;
+	bool active, is_writer, new_client, wait_for_open, timestamps, stats,
+	     partial;
 };
 
 static void thd_entry_event_signal(struct ThdEntry *thd)
@@ -412,6 +414,80 @@ static ssize_t receive_sample(const struct iio_channel *chn,
 	return read_all(info->pdata, dst, length);
 }
 
+/* Time elapsed since the samples of the buffer were captured, in microseconds */
+static long buffer_age_us(const struct iio_buffer *buf)
+{
+	uint64_t timestamp = iio_buffer_get_timestamp(buf);
+	struct timespec now;
+	uint64_t now_ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	now_ns = (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+
+	if (!timestamp || timestamp > now_ns)
+		return 0;
+
+	return (long) ((now_ns - timestamp) / 1000);
+}
+
+/* Sends one line of statistics for each channel of the mask, computed over
+ * the first 'samples_count' samples of the buffer, instead of the samples
+ * themselves */
+static ssize_t send_stats(struct parser_pdata *pdata, struct DevEntry *dev,
+		uint32_t *mask, size_t samples_count)
+{
+	unsigned int i, nb = 0,
+		     nb_channels = iio_device_get_channels_count(dev->dev);
+	const struct iio_channel **chns;
+	struct iio_channel_stats *stats;
+	char line[256];
+	ssize_t ret;
+	int len;
+
+	chns = malloc(nb_channels * sizeof(*chns));
+	if (!chns)
+		return -ENOMEM;
+
+	stats = malloc(nb_channels * sizeof(*stats));
+	if (!stats) {
+		ret = -ENOMEM;
+		goto err_free_chns;
+	}
+
+	for (i = 0; i < nb_channels; i++) {
+		if (TEST_BIT(mask, i))
+			chns[nb++] = iio_device_get_channel(dev->dev, i);
+	}
+
+	ret = iio_buffer_compute_stats_partial(dev->buf, chns, nb, stats,
+			samples_count);
+	if (ret < 0)
+		goto err_free_stats;
+
+	for (i = 0; i < nb; i++) {
+		len = iio_snprintf(line, sizeof(line), "%" PRIu64 " %" PRId64
+				" %" PRId64 " %" PRId64 " %.17g %" PRIu64 "\n",
+				stats[i].count, stats[i].min, stats[i].max,
+				stats[i].sum, stats[i].sum_squares,
+				stats[i].clipped);
+		if (len < 0 || (size_t) len >= sizeof(line)) {
+			ret = -EOVERFLOW;
+			goto err_free_stats;
+		}
+
+		ret = write_all(pdata, line, len);
+		if (ret < 0)
+			goto err_free_stats;
+	}
+
+	ret = 0;
+err_free_stats:
+	free(stats);
+err_free_chns:
+	free(chns);
+	return ret;
+}
+
 static ssize_t send_data(struct DevEntry *dev, struct ThdEntry *thd, size_t len)
 {
 	struct parser_pdata *pdata = thd->pdata;
@@ -424,6 +500,9 @@ static ssize_t send_data(struct DevEntry *dev, struct ThdEntry *thd, size_t len)
 
 	print_value(pdata, len);
 
+	if (thd->timestamps)
+		print_value(pdata, buffer_age_us(dev->buf));
+
 	if (thd->new_client) {
 		unsigned int i;
 		char buf[129], *ptr = buf;
@@ -443,6 +522,15 @@ static ssize_t send_data(struct DevEntry *dev, struct ThdEntry *thd, size_t len)
 		thd->new_client = false;
 	}
 
+	if (thd->stats) {
+		ssize_t ret;
+
+		/* The statistics cover as many samples as 'len' would */
+		ret = send_stats(pdata, dev, demux ? thd->mask : dev->mask,
+				len / thd->sample_size);
+		return ret < 0 ? ret : (ssize_t) len;
+	}
+
 	if (!demux) {
 		/* Short path */
 		return write_all(pdata, dev->buf->buffer, len);
@@ -533,6 +621,7 @@ static void rw_thd(struct thread_pool *pool, void *d)
 		bool has_readers = false, has_writers = false,
 		     mask_updated = false;
 		unsigned int sample_size;
+		size_t min_samples = SIZE_MAX;
 
 		/* NOTE: this while loop must exit with thdlist_lock locked. */
 		pthread_mutex_lock(&entry->thdlist_lock);
@@ -553,9 +642,6 @@ static void rw_thd(struct thread_pool *pool, void *d)
 					samples_count = thd->samples_count;
 			}
 
-			if (entry->buf)
-				iio_buffer_destroy(entry->buf);
-
 			for (i = 0; i < dev->nb_channels; i++) {
 				struct iio_channel *chn = dev->channels[i];
 				long index = chn->index;
@@ -566,8 +652,17 @@ static void rw_thd(struct thread_pool *pool, void *d)
 					iio_channel_disable(chn);
 			}
 
-			entry->buf = iio_device_create_buffer(dev,
-					samples_count, entry->cyclic);
+			/* Keep the device opened when a client joins or
+			 * leaves; only re-create the buffer if that fails */
+			if (entry->buf && iio_buffer_reconfigure(entry->buf,
+						samples_count) < 0) {
+				iio_buffer_destroy(entry->buf);
+				entry->buf = NULL;
+			}
+
+			if (!entry->buf)
+				entry->buf = iio_device_create_buffer(dev,
+						samples_count, entry->cyclic);
 			if (!entry->buf) {
 				ret = -errno;
 				ERROR("Unable to create buffer\n");
@@ -600,10 +695,20 @@ static void rw_thd(struct thread_pool *pool, void *d)
 			if (mask_updated && thd->active)
 				signal_thread(thd, thd->nb);
 
-			if (thd->is_writer)
+			if (thd->is_writer) {
 				has_writers |= thd->active;
-			else
-				has_readers |= thd->active;
+			} else if (thd->active) {
+				unsigned int thd_sample_size = server_demux ?
+					thd->sample_size : sample_size;
+
+				/* Number of samples the reader still waits for,
+				 * if it asked for a partial refill */
+				has_readers = true;
+				if (thd->partial && thd_sample_size &&
+						thd->nb / thd_sample_size
+						< min_samples)
+					min_samples = thd->nb / thd_sample_size;
+			}
 		}
 
 		if (!has_readers && !has_writers) {
@@ -619,7 +724,15 @@ static void rw_thd(struct thread_pool *pool, void *d)
 		if (has_readers) {
 			ssize_t nb_bytes;
 
-			ret = iio_buffer_refill(entry->buf);
+			/* Answer the readers that asked for a partial refill as
+			 * soon as they can be, instead of waiting for the whole
+			 * buffer to be filled */
+			if (min_samples && min_samples <
+					entry->buf->length / sample_size)
+				ret = iio_buffer_refill_min(entry->buf,
+						min_samples);
+			else
+				ret = iio_buffer_refill(entry->buf);
 
 			pthread_mutex_lock(&entry->thdlist_lock);
 
@@ -759,8 +872,8 @@ static struct ThdEntry *parser_lookup_thd_entry(struct parser_pdata *pdata,
 	return NULL;
 }
 
-static ssize_t rw_buffer(struct parser_pdata *pdata,
-		struct iio_device *dev, unsigned int nb, bool is_write)
+static ssize_t rw_buffer(struct parser_pdata *pdata, struct iio_device *dev,
+		unsigned int nb, unsigned int flags)
 {
 	struct DevEntry *entry;
 	struct ThdEntry *thd;
@@ -769,6 +882,10 @@ static ssize_t rw_buffer(struct parser_pdata *pdata,
 	if (!dev)
 		return -ENODEV;
 
+	/* The timestamp and the statistics share the header of the reply */
+	if ((flags & RW_TIMESTAMPS) && (flags & RW_STATS))
+		return -EINVAL;
+
 	thd = parser_lookup_thd_entry(pdata, dev);
 	if (!thd)
 		return -EBADF;
@@ -792,7 +909,10 @@ static ssize_t rw_buffer(struct parser_pdata *pdata,
 	thd->new_client = true;
 	thd->nb = nb;
 	thd->err = 0;
-	thd->is_writer = is_write;
+	thd->is_writer = !!(flags & RW_WRITE);
+	thd->timestamps = !!(flags & RW_TIMESTAMPS);
+	thd->stats = !!(flags & RW_STATS);
+	thd->partial = !!(flags & RW_PARTIAL);
 	thd->active = true;
 
 	pthread_cond_signal(&entry->rw_ready_cond);
@@ -1079,10 +1199,10 @@ int close_dev(struct parser_pdata *pdata, struct iio_device *dev)
 }
 
 ssize_t rw_dev(struct parser_pdata *pdata, struct iio_device *dev,
-		unsigned int nb, bool is_write)
+		unsigned int nb, unsigned int flags)
 {
-	ssize_t ret = rw_buffer(pdata, dev, nb, is_write);
-	if (ret <= 0 || is_write)
+	ssize_t ret = rw_buffer(pdata, dev, nb, flags);
+	if (ret <= 0 || (flags & RW_WRITE))
 		print_value(pdata, ret);
 	return ret;
 }
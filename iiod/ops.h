@@ -85,8 +85,14 @@ int open_dev(struct parser_pdata *pdata, struct iio_device *dev,
 		size_t samples_count, const char *mask, bool cyclic);
 int close_dev(struct parser_pdata *pdata, struct iio_device *dev);
 
+/* Flags of rw_dev(); TIMESTAMPS, STATS and PARTIAL are READBUF options */
+#define RW_WRITE	(1 << 0)
+#define RW_TIMESTAMPS	(1 << 1)
+#define RW_STATS	(1 << 2)
+#define RW_PARTIAL	(1 << 3)
+
 ssize_t rw_dev(struct parser_pdata *pdata, struct iio_device *dev,
-		unsigned int nb, bool is_write);
+		unsigned int nb, unsigned int flags);
 
 ssize_t read_dev_attr(struct parser_pdata *pdata, struct iio_device *dev,
 		const char *attr, bool is_debug);
@@ -65,6 +65,7 @@ ssize_t yy_input(yyscan_t scanner, char *buf, size_t max_size);
 	struct iio_device *dev;
 	struct iio_channel *chn;
 	long value;
+	unsigned int flags;
 }
 
 %token SPACE
@@ -86,6 +87,9 @@ ssize_t yy_input(yyscan_t scanner, char *buf, size_t max_size);
 %token DEBUG_ATTR
 %token IN_OUT
 %token CYCLIC
+%token TIMESTAMPS
+%token STATS
+%token PARTIAL
 %token SET
 %token BUFFERS_COUNT
 
@@ -94,6 +98,8 @@ ssize_t yy_input(yyscan_t scanner, char *buf, size_t max_size);
 %token <chn> CHANNEL
 %token <value> VALUE;
 
+%type <flags> ReadbufOpts
+
 %destructor { DEBUG("Freeing token \"%s\"\n", $$); free($$); } <word>
 
 %start Line
@@ -129,7 +135,7 @@ Line:
 		"\t\tRead the value of an attribute\n"
 		"\tWRITE <device> DEBUG|[INPUT|OUTPUT <channel>] [<attribute>] <bytes_count>\n"
 		"\t\tSet the value of an attribute\n"
-		"\tREADBUF <device> <bytes_count>\n"
+		"\tREADBUF <device> <bytes_count> [PARTIAL] [TIMESTAMPS|STATS]\n"
 		"\t\tRead raw data from the specified device\n"
 		"\tWRITEBUF <device> <bytes_count>\n"
 		"\t\tWrite raw data to the specified device\n"
@@ -255,11 +261,11 @@ Line:
 		else
 			YYACCEPT;
 	}
-	| READBUF SPACE DEVICE SPACE WORD END {
+	| READBUF SPACE DEVICE SPACE WORD ReadbufOpts END {
 		char *len = $5;
 		unsigned long nb = atol(len);
 		struct parser_pdata *pdata = yyget_extra(scanner);
-		ssize_t ret = rw_dev(pdata, $3, nb, false);
+		ssize_t ret = rw_dev(pdata, $3, nb, $6);
 		free(len);
 		if (ret < 0)
 			YYABORT;
@@ -270,7 +276,7 @@ Line:
 		char *len = $5;
 		unsigned long nb = atol(len);
 		struct parser_pdata *pdata = yyget_extra(scanner);
-		ssize_t ret = rw_dev(pdata, $3, nb, true);
+		ssize_t ret = rw_dev(pdata, $3, nb, RW_WRITE);
 
 		/* Discard additional data */
 		yyclearin;
@@ -388,6 +394,21 @@ Line:
 	}
 	;
 
+ReadbufOpts:
+	/* empty */ {
+		$$ = 0;
+	}
+	| ReadbufOpts SPACE PARTIAL {
+		$$ = $1 | RW_PARTIAL;
+	}
+	| ReadbufOpts SPACE TIMESTAMPS {
+		$$ = $1 | RW_TIMESTAMPS;
+	}
+	| ReadbufOpts SPACE STATS {
+		$$ = $1 | RW_STATS;
+	}
+	;
+
 %%
 
 void yyerror(yyscan_t scanner, const char *msg)
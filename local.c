@@ -17,6 +17,7 @@
  * */
 
 #include "debug.h"
+#include "iio-lock.h"
 #include "iio-private.h"
 
 #include <dirent.h>
@@ -41,11 +42,20 @@
 #ifdef WITH_LOCAL_CONFIG
 #include <ini.h>
 #endif
+#ifndef NO_THREADS
+#include <pthread.h>
+#endif
 
 #define DEFAULT_TIMEOUT_MS 1000
 
 #define NB_BLOCKS 4
 
+/* Maximum number of attribute files kept open by a context */
+#define NB_ATTR_FDS 64
+
+/* Maximum number of threads creating the devices of a context */
+#define NB_CREATE_THREADS 8
+
 #define BLOCK_ALLOC_IOCTL   _IOWR('i', 0xa0, struct block_alloc_req)
 #define BLOCK_FREE_IOCTL      _IO('i', 0xa1)
 #define BLOCK_QUERY_IOCTL   _IOWR('i', 0xa2, struct block)
@@ -81,8 +91,33 @@ struct block {
 	uint64_t timestamp;
 };
 
+/* An attribute file kept open, so that accessing it again only costs one
+ * pread() or pwrite() */
+struct attr_fd {
+	const struct iio_device *dev;
+	char *filename;
+	bool is_debug, is_write;
+	int fd;
+
+	/* Set for files outside of sysfs, e.g. a copy of a sysfs tree */
+	bool is_regular;
+
+	/* Number of threads using the fd; it is only closed when zero */
+	unsigned int users;
+	uint64_t last_use;
+};
+
 struct iio_context_pdata {
 	unsigned int rw_timeout_ms;
+
+	/* Prefix of the sysfs, debugfs and /dev paths, "" by default */
+	char *root;
+
+	/* Protects the cache of attribute files, and the directory fds of the
+	 * devices */
+	struct iio_mutex *attr_fds_lock;
+	struct attr_fd attr_fds[NB_ATTR_FDS];
+	uint64_t attr_fds_clock;
 };
 
 struct iio_device_pdata {
@@ -95,11 +130,19 @@ struct iio_device_pdata {
 	int last_dequeued;
 	bool is_high_speed, cyclic, cyclic_buffer_enqueued, buffer_enabled;
 
+	/* Number of blocks enqueued to the kernel */
+	unsigned int nb_queued;
+
 	int cancel_fd;
+
+	/* Directories of the device in sysfs and debugfs, opened on the first
+	 * attribute access, or -1 */
+	int sysfs_fd, debug_fd;
 };
 
 struct iio_channel_pdata {
 	char *enable_fn;
+	bool enabled; /* Last state written to 'enable_fn' */
 	struct iio_channel_attr *protected_attrs;
 	unsigned int nb_protected_attrs;
 };
@@ -128,14 +171,43 @@ static void local_free_channel_pdata(struct iio_channel *chn)
 	}
 }
 
+/* Closes the cached files of a device which is about to be freed, so that
+ * a device allocated later at the same address does not find them */
+static void drop_attr_fds(const struct iio_device *dev)
+{
+	struct iio_context_pdata *ctx_pdata = dev->ctx->pdata;
+	unsigned int i;
+
+	iio_mutex_lock(ctx_pdata->attr_fds_lock);
+
+	for (i = 0; i < NB_ATTR_FDS; i++) {
+		struct attr_fd *entry = &ctx_pdata->attr_fds[i];
+
+		if (entry->filename && entry->dev == dev) {
+			close(entry->fd);
+			free(entry->filename);
+			entry->filename = NULL;
+		}
+	}
+
+	iio_mutex_unlock(ctx_pdata->attr_fds_lock);
+}
+
 static void local_free_pdata(struct iio_device *device)
 {
 	unsigned int i;
 
+	if (device->ctx && device->ctx->pdata->attr_fds_lock)
+		drop_attr_fds(device);
+
 	for (i = 0; i < device->nb_channels; i++)
 		local_free_channel_pdata(device->channels[i]);
 
 	if (device->pdata) {
+		if (device->pdata->sysfs_fd >= 0)
+			close(device->pdata->sysfs_fd);
+		if (device->pdata->debug_fd >= 0)
+			close(device->pdata->debug_fd);
 		free(device->pdata->blocks);
 		free(device->pdata->addrs);
 		free(device->pdata);
@@ -151,9 +223,24 @@ static void local_shutdown(struct iio_context *ctx)
 		struct iio_device *dev = ctx->devices[i];
 
 		iio_device_close(dev);
-		local_free_pdata(dev);
 	}
 
+	for (i = 0; i < NB_ATTR_FDS; i++) {
+		struct attr_fd *entry = &ctx->pdata->attr_fds[i];
+
+		if (entry->filename) {
+			close(entry->fd);
+			free(entry->filename);
+			entry->filename = NULL;
+		}
+	}
+
+	for (i = 0; i < ctx->nb_devices; i++)
+		local_free_pdata(ctx->devices[i]);
+
+	if (ctx->pdata->attr_fds_lock)
+		iio_mutex_destroy(ctx->pdata->attr_fds_lock);
+	free(ctx->pdata->root);
 	free(ctx->pdata);
 }
 
@@ -306,14 +393,14 @@ static int device_check_ready(const struct iio_device *dev, short events,
 	return 0;
 }
 
-static ssize_t local_read(const struct iio_device *dev,
-		void *dst, size_t len, uint32_t *mask, size_t words)
+static ssize_t read_min(const struct iio_device *dev, void *dst,
+		size_t len, size_t min_len, uint32_t *mask, size_t words)
 {
 	struct iio_device_pdata *pdata = dev->pdata;
 	uintptr_t ptr = (uintptr_t) dst;
 	struct timespec start;
 	ssize_t readsize;
-	ssize_t ret;
+	ssize_t ret = 0;
 
 	if (pdata->fd == -1)
 		return -EBADF;
@@ -327,7 +414,7 @@ static ssize_t local_read(const struct iio_device *dev,
 
 	clock_gettime(CLOCK_MONOTONIC, &start);
 
-	while (len > 0) {
+	while (ptr - (uintptr_t) dst < min_len) {
 		ret = device_check_ready(dev, POLLIN, &start);
 		if (ret < 0)
 			break;
@@ -357,6 +444,12 @@ static ssize_t local_read(const struct iio_device *dev,
 		return ret;
 }
 
+static ssize_t local_read(const struct iio_device *dev,
+		void *dst, size_t len, uint32_t *mask, size_t words)
+{
+	return read_min(dev, dst, len, len, mask, words);
+}
+
 static ssize_t local_write(const struct iio_device *dev,
 		const void *src, size_t len)
 {
@@ -420,6 +513,21 @@ static ssize_t local_enable_buffer(const struct iio_device *dev)
 	return 0;
 }
 
+static ssize_t local_read_min(const struct iio_device *dev,
+		void *dst, size_t len, size_t min_len,
+		uint32_t *mask, size_t words)
+{
+	if (dev->pdata->is_high_speed)
+		return -ENOSYS;
+
+	/* The buffer/watermark attribute is left alone: the kernel only
+	 * accepts a new value while the buffer is disabled, and restarting
+	 * the capture would drop the samples already queued. poll() wakes up
+	 * at the current watermark (one sample by default), and read()
+	 * returns all the samples available, up to 'len' bytes */
+	return read_min(dev, dst, len, min_len, mask, words);
+}
+
 static int local_set_kernel_buffers_count(const struct iio_device *dev,
 		unsigned int nb_blocks)
 {
@@ -433,13 +541,51 @@ static int local_set_kernel_buffers_count(const struct iio_device *dev,
 	return 0;
 }
 
+static ssize_t dequeue_block(const struct iio_device *dev, struct block *block)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	struct timespec start;
+	char err_str[1024];
+	ssize_t ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do {
+		ret = (ssize_t) device_check_ready(dev, POLLIN | POLLOUT, &start);
+		if (ret < 0)
+			return ret;
+
+		memset(block, 0, sizeof(*block));
+		ret = (ssize_t) ioctl_nointr(pdata->fd,
+				BLOCK_DEQUEUE_IOCTL, block);
+	} while (pdata->blocking && ret == -1 && errno == EAGAIN);
+
+	if (ret) {
+		ret = (ssize_t) -errno;
+		if ((!pdata->blocking && ret != -EAGAIN) ||
+				(pdata->blocking && ret != -ETIMEDOUT)) {
+			iio_strerror(errno, err_str, sizeof(err_str));
+			ERROR("Unable to dequeue block: %s\n", err_str);
+		}
+		return ret;
+	}
+
+	/* Every block is now owned by the application: the DMA has nowhere
+	 * to write to (or nothing to read from) until one is enqueued */
+	if (!__atomic_sub_fetch(&pdata->nb_queued, 1, __ATOMIC_RELAXED) &&
+			dev->buffer)
+		__atomic_add_fetch(&dev->buffer->stats.queue_empty, 1,
+				__ATOMIC_RELAXED);
+
+	return 0;
+}
+
 static ssize_t local_get_buffer(const struct iio_device *dev,
 		void **addr_ptr, size_t bytes_used,
 		uint32_t *mask, size_t words)
 {
 	struct block block;
 	struct iio_device_pdata *pdata = dev->pdata;
-	struct timespec start;
 	char err_str[1024];
 	int f = pdata->fd;
 	ssize_t ret;
@@ -471,38 +617,96 @@ static ssize_t local_get_buffer(const struct iio_device *dev,
 			return ret;
 		}
 
+		__atomic_add_fetch(&pdata->nb_queued, 1, __ATOMIC_RELAXED);
+
 		if (pdata->cyclic) {
 			*addr_ptr = pdata->addrs[pdata->last_dequeued];
 			return (ssize_t) last_block->bytes_used;
 		}
 	}
 
-	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = dequeue_block(dev, &block);
+	if (ret < 0)
+		return ret;
 
-	do {
-		ret = (ssize_t) device_check_ready(dev, POLLIN | POLLOUT, &start);
-		if (ret < 0)
-			return ret;
+	/* Requested buffer size is too big! */
+	if (pdata->last_dequeued < 0 && bytes_used != block.size)
+		return -EFBIG;
 
-		memset(&block, 0, sizeof(block));
-		ret = (ssize_t) ioctl_nointr(f, BLOCK_DEQUEUE_IOCTL, &block);
-	} while (pdata->blocking && ret == -1 && errno == EAGAIN);
+	pdata->last_dequeued = block.id;
+	*addr_ptr = pdata->addrs[block.id];
+	return (ssize_t) block.bytes_used;
+}
+
+static int local_enqueue_block(const struct iio_device *dev,
+		unsigned int id, size_t bytes_used)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	char err_str[1024];
+	int ret;
 
+	if (!pdata->is_high_speed)
+		return -ENOSYS;
+	if (pdata->fd == -1)
+		return -EBADF;
+	if (pdata->cyclic)
+		return -EPERM;
+	if (id >= pdata->nb_blocks || bytes_used > pdata->blocks[id].size)
+		return -EINVAL;
+
+	pdata->blocks[id].bytes_used = bytes_used;
+	ret = ioctl_nointr(pdata->fd, BLOCK_ENQUEUE_IOCTL, &pdata->blocks[id]);
 	if (ret) {
-		ret = (ssize_t) -errno;
-		if ((!pdata->blocking && ret != -EAGAIN) ||
-				(pdata->blocking && ret != -ETIMEDOUT)) {
-			iio_strerror(errno, err_str, sizeof(err_str));
-			ERROR("Unable to dequeue block: %s\n", err_str);
-		}
+		ret = -errno;
+		iio_strerror(errno, err_str, sizeof(err_str));
+		ERROR("Unable to enqueue block: %s\n", err_str);
 		return ret;
 	}
 
-	/* Requested buffer size is too big! */
-	if (pdata->last_dequeued < 0 && bytes_used != block.size)
-		return -EFBIG;
+	__atomic_add_fetch(&pdata->nb_queued, 1, __ATOMIC_RELAXED);
+	return 0;
+}
 
-	pdata->last_dequeued = block.id;
+static ssize_t local_dequeue_block(const struct iio_device *dev,
+		unsigned int *id, void **addr_ptr)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	struct block block;
+	ssize_t ret;
+
+	if (!pdata->is_high_speed)
+		return -ENOSYS;
+	if (pdata->fd == -1)
+		return -EBADF;
+	if (pdata->cyclic)
+		return -EPERM;
+
+	/* The block last returned by get_buffer() is not in the kernel's
+	 * queue. An output block is still waiting to be filled, so it is
+	 * handed over as-is; an input block was already consumed, so it
+	 * goes back to the kernel first. */
+	if (pdata->last_dequeued >= 0) {
+		unsigned int last = (unsigned int) pdata->last_dequeued;
+
+		pdata->last_dequeued = -1;
+
+		if (iio_device_is_tx(dev)) {
+			*id = last;
+			*addr_ptr = pdata->addrs[last];
+			return (ssize_t) pdata->blocks[last].size;
+		}
+
+		ret = (ssize_t) local_enqueue_block(dev, last,
+				pdata->blocks[last].size);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = dequeue_block(dev, &block);
+	if (ret < 0)
+		return ret;
+
+	*id = block.id;
 	*addr_ptr = pdata->addrs[block.id];
 	return (ssize_t) block.bytes_used;
 }
@@ -637,65 +841,244 @@ static ssize_t local_write_all_chn_attrs(const struct iio_channel *chn,
 	return ptr - src;
 }
 
+/* Returns the directory of the device in sysfs or debugfs, opening it on
+ * the first call. Must be called with attr_fds_lock held. */
+static int get_dir_fd(const struct iio_device *dev, bool is_debug)
+{
+	int *fd = is_debug ? &dev->pdata->debug_fd : &dev->pdata->sysfs_fd;
+	const char *root = dev->ctx->pdata->root;
+	char buf[1024];
+
+	if (*fd >= 0)
+		return *fd;
+
+	if (is_debug) {
+		iio_snprintf(buf, sizeof(buf), "%s/sys/kernel/debug/iio/%s",
+				root, dev->id);
+	} else {
+		iio_snprintf(buf, sizeof(buf), "%s/sys/bus/iio/devices/%s",
+				root, dev->id);
+	}
+
+	*fd = open(buf, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (*fd < 0)
+		return -errno;
+
+	return *fd;
+}
+
+/* Looks up a file in the cache of the context, which must be locked. On a
+ * miss, *slot is set to the entry to replace with the file, or NULL if all
+ * the entries are in use. */
+static struct attr_fd * find_attr_fd(struct iio_context_pdata *ctx_pdata,
+		const struct iio_device *dev, const char *attr,
+		bool is_debug, bool is_write, struct attr_fd **slot)
+{
+	unsigned int i;
+
+	*slot = NULL;
+
+	for (i = 0; i < NB_ATTR_FDS; i++) {
+		struct attr_fd *cur = &ctx_pdata->attr_fds[i];
+
+		if (!cur->filename) {
+			if (!*slot || (*slot)->filename)
+				*slot = cur;
+			continue;
+		}
+
+		if (cur->dev == dev && cur->is_debug == is_debug &&
+				cur->is_write == is_write &&
+				!strcmp(cur->filename, attr))
+			return cur;
+
+		/* Prefer a free slot, then the least recently used one */
+		if (!cur->users && (!*slot || ((*slot)->filename &&
+						cur->last_use < (*slot)->last_use)))
+			*slot = cur;
+	}
+
+	return NULL;
+}
+
+/* Returns a fd to the attribute file, opened for reading or for writing.
+ * Up to NB_ATTR_FDS files stay open in the cache of the context; the least
+ * recently used one that no other thread is using makes room for a new one.
+ * When the cache is full of busy files, the fd is not cached: *entry is then
+ * set to NULL, and put_attr_fd() closes it. */
+static int get_attr_fd(const struct iio_device *dev, const char *attr,
+		bool is_debug, bool is_write, struct attr_fd **entry)
+{
+	struct iio_context_pdata *ctx_pdata = dev->ctx->pdata;
+	struct attr_fd *cur, *slot;
+	int fd, dir_fd;
+
+	iio_mutex_lock(ctx_pdata->attr_fds_lock);
+
+	cur = find_attr_fd(ctx_pdata, dev, attr, is_debug, is_write, &slot);
+	if (cur)
+		goto out_use_entry;
+
+	dir_fd = get_dir_fd(dev, is_debug);
+	iio_mutex_unlock(ctx_pdata->attr_fds_lock);
+	if (dir_fd < 0)
+		return dir_fd;
+
+	/* The file is opened without holding the lock, so that the threads
+	 * creating the devices of a context do not wait for each other */
+	fd = openat(dir_fd, attr, (is_write ? O_WRONLY : O_RDONLY) |
+			O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	iio_mutex_lock(ctx_pdata->attr_fds_lock);
+
+	/* Another thread may have opened the same file in the meantime */
+	cur = find_attr_fd(ctx_pdata, dev, attr, is_debug, is_write, &slot);
+	if (cur) {
+		close(fd);
+		goto out_use_entry;
+	}
+
+	*entry = NULL;
+
+	if (slot) {
+		char *filename = iio_strdup(attr);
+
+		if (filename) {
+			struct stat st;
+
+			if (slot->filename) {
+				close(slot->fd);
+				free(slot->filename);
+			}
+
+			slot->dev = dev;
+			slot->filename = filename;
+			slot->is_debug = is_debug;
+			slot->is_write = is_write;
+			slot->fd = fd;
+			slot->is_regular = !fstat(fd, &st) &&
+				S_ISREG(st.st_mode);
+			slot->users = 1;
+			slot->last_use = ++ctx_pdata->attr_fds_clock;
+			*entry = slot;
+		}
+	}
+
+	iio_mutex_unlock(ctx_pdata->attr_fds_lock);
+	return fd;
+
+out_use_entry:
+	cur->users++;
+	cur->last_use = ++ctx_pdata->attr_fds_clock;
+	iio_mutex_unlock(ctx_pdata->attr_fds_lock);
+
+	*entry = cur;
+	return cur->fd;
+}
+
+/* Releases a fd obtained with get_attr_fd(). After an error, the file is
+ * dropped from the cache, so that it is opened again the next time. */
+static void put_attr_fd(const struct iio_device *dev,
+		struct attr_fd *entry, int fd, bool failed)
+{
+	struct iio_context_pdata *ctx_pdata = dev->ctx->pdata;
+
+	if (!entry) {
+		close(fd);
+		return;
+	}
+
+	iio_mutex_lock(ctx_pdata->attr_fds_lock);
+
+	if (!--entry->users && failed) {
+		close(entry->fd);
+		free(entry->filename);
+		entry->filename = NULL;
+	}
+
+	iio_mutex_unlock(ctx_pdata->attr_fds_lock);
+}
+
 static ssize_t local_read_dev_attr(const struct iio_device *dev,
 		const char *attr, char *dst, size_t len, bool is_debug)
 {
-	FILE *f;
-	char buf[1024];
+	struct attr_fd *entry;
+	size_t nb = 0;
 	ssize_t ret;
+	int fd;
 
 	if (!attr)
 		return local_read_all_dev_attrs(dev, dst, len, is_debug);
 
-	if (is_debug) {
-		iio_snprintf(buf, sizeof(buf), "/sys/kernel/debug/iio/%s/%s",
-				dev->id, attr);
-	} else {
-		iio_snprintf(buf, sizeof(buf), "/sys/bus/iio/devices/%s/%s",
-				dev->id, attr);
+	fd = get_attr_fd(dev, attr, is_debug, false, &entry);
+	if (fd < 0)
+		return fd;
+
+	/* Reading from the start makes sysfs generate the value again. A
+	 * short read means that the whole value was read. */
+	while (nb < len) {
+		ret = pread(fd, dst + nb, len - nb, (off_t) nb);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			ret = -errno;
+			put_attr_fd(dev, entry, fd, true);
+			return ret;
+		}
+
+		nb += (size_t) ret;
+		if (!ret || nb < len)
+			break;
 	}
 
-	f = fopen(buf, "re");
-	if (!f)
-		return -errno;
+	put_attr_fd(dev, entry, fd, false);
 
-	ret = fread(dst, 1, len, f);
-	if (ret > 0)
-		dst[ret - 1] = '\0';
-	fflush(f);
-	if (ferror(f))
-		ret = -errno;
-	fclose(f);
-	return ret ? ret : -EIO;
+	if (nb > 0)
+		dst[nb - 1] = '\0';
+	return nb ? (ssize_t) nb : -EIO;
+}
+
+static bool is_regular_file(const struct attr_fd *entry, int fd)
+{
+	struct stat st;
+
+	if (entry)
+		return entry->is_regular;
+
+	return !fstat(fd, &st) && S_ISREG(st.st_mode);
 }
 
 static ssize_t local_write_dev_attr(const struct iio_device *dev,
 		const char *attr, const char *src, size_t len, bool is_debug)
 {
-	FILE *f;
-	char buf[1024];
+	struct attr_fd *entry;
 	ssize_t ret;
+	int fd;
 
 	if (!attr)
 		return local_write_all_dev_attrs(dev, src, len, is_debug);
 
-	if (is_debug) {
-		iio_snprintf(buf, sizeof(buf), "/sys/kernel/debug/iio/%s/%s",
-				dev->id, attr);
-	} else {
-		iio_snprintf(buf, sizeof(buf), "/sys/bus/iio/devices/%s/%s",
-				dev->id, attr);
-	}
+	fd = get_attr_fd(dev, attr, is_debug, true, &entry);
+	if (fd < 0)
+		return fd;
 
-	f = fopen(buf, "we");
-	if (!f)
-		return -errno;
+	do {
+		ret = pwrite(fd, src, len, 0);
+	} while (ret < 0 && errno == EINTR);
+
+	if (ret < 0)
+		ret = -errno;
 
-	ret = fwrite(src, 1, len, f);
-	fflush(f);
-	if (ferror(f))
+	/* Writing to sysfs replaces the value; a regular file would keep the
+	 * end of a longer previous value */
+	if (ret >= 0 && is_regular_file(entry, fd) &&
+			ftruncate(fd, (off_t) ret))
 		ret = -errno;
-	fclose(f);
+
+	put_attr_fd(dev, entry, fd, ret < 0);
 	return ret ? ret : -EIO;
 }
 
@@ -741,8 +1124,9 @@ static int channel_write_state(const struct iio_channel *chn, bool en)
 	ret = local_write_chn_attr(chn, chn->pdata->enable_fn, en ? "1" : "0", 2);
 	if (ret < 0)
 		return (int) ret;
-	else
-		return 0;
+
+	chn->pdata->enabled = en;
+	return 0;
 }
 
 static int enable_high_speed(const struct iio_device *dev)
@@ -772,6 +1156,8 @@ static int enable_high_speed(const struct iio_device *dev)
 		return -ENOMEM;
 	}
 
+	pdata->nb_queued = 0;
+
 	req.id = 0;
 	req.type = 0;
 	req.size = pdata->samples_count *
@@ -802,6 +1188,8 @@ static int enable_high_speed(const struct iio_device *dev)
 			goto err_munmap;
 		}
 
+		pdata->nb_queued++;
+
 		pdata->addrs[i] = mmap(0, pdata->blocks[i].size,
 				PROT_READ | PROT_WRITE,
 				MAP_SHARED, fd, pdata->blocks[i].offset);
@@ -851,7 +1239,8 @@ static int local_open(const struct iio_device *dev,
 	if (pdata->cancel_fd == -1)
 		return -errno;
 
-	iio_snprintf(buf, sizeof(buf), "/dev/%s", dev->id);
+	iio_snprintf(buf, sizeof(buf), "%s/dev/%s",
+			dev->ctx->pdata->root, dev->id);
 	pdata->fd = open(buf, O_RDWR | O_CLOEXEC | O_NONBLOCK);
 	if (pdata->fd == -1) {
 		ret = -errno;
@@ -917,26 +1306,104 @@ err_close_cancel_fd:
 	return ret;
 }
 
-static int local_close(const struct iio_device *dev)
+static void disable_high_speed(const struct iio_device *dev)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	unsigned int i;
+
+	for (i = 0; i < pdata->nb_blocks; i++)
+		munmap(pdata->addrs[i], pdata->blocks[i].size);
+	ioctl_nointr(pdata->fd, BLOCK_FREE_IOCTL, 0);
+	free(pdata->addrs);
+	pdata->addrs = NULL;
+	free(pdata->blocks);
+	pdata->blocks = NULL;
+}
+
+/* Unlike a close() followed by open(), this keeps the character device
+ * opened, and only writes the scan elements whose state changed */
+static int local_reconfigure(const struct iio_device *dev,
+		size_t samples_count)
 {
 	struct iio_device_pdata *pdata = dev->pdata;
 	unsigned int i;
+	char buf[32];
 	int ret;
 
 	if (pdata->fd == -1)
 		return -EBADF;
 
+	ret = local_write_dev_attr(dev, "buffer/enable", "0", 2, false);
+	if (ret < 0)
+		return ret;
+
+	pdata->buffer_enabled = false;
+
+	/* The DMA blocks are sized for the previous sample size */
+	if (pdata->is_high_speed)
+		disable_high_speed(dev);
+
+	for (i = 0; i < dev->nb_channels; i++) {
+		struct iio_channel *chn = dev->channels[i];
+
+		if (chn->index >= 0 && chn->pdata->enabled &&
+				!iio_channel_is_enabled(chn)) {
+			ret = channel_write_state(chn, false);
+			if (ret < 0)
+				return ret;
+		}
+	}
+	for (i = 0; i < dev->nb_channels; i++) {
+		struct iio_channel *chn = dev->channels[i];
+
+		if (chn->index >= 0 && !chn->pdata->enabled &&
+				iio_channel_is_enabled(chn)) {
+			ret = channel_write_state(chn, true);
+			if (ret < 0)
+				return ret;
+		}
+	}
+
+	if (samples_count != pdata->samples_count) {
+		unsigned long length = samples_count;
+
+		if (!pdata->is_high_speed)
+			length *= pdata->nb_blocks;
+
+		iio_snprintf(buf, sizeof(buf), "%lu", length);
+		ret = local_write_dev_attr(dev, "buffer/length",
+				buf, strlen(buf) + 1, false);
+		if (ret < 0)
+			return ret;
+
+		pdata->samples_count = samples_count;
+	}
+
+	pdata->cyclic_buffer_enqueued = false;
+
 	if (pdata->is_high_speed) {
-		unsigned int i;
-		for (i = 0; i < pdata->nb_blocks; i++)
-			munmap(pdata->addrs[i], pdata->blocks[i].size);
-		ioctl_nointr(pdata->fd, BLOCK_FREE_IOCTL, 0);
-		free(pdata->addrs);
-		pdata->addrs = NULL;
-		free(pdata->blocks);
-		pdata->blocks = NULL;
+		ret = enable_high_speed(dev);
+		if (ret < 0) {
+			pdata->is_high_speed = false;
+			return ret;
+		}
 	}
 
+	return (int) local_enable_buffer(dev);
+}
+
+static int local_close(const struct iio_device *dev)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	unsigned int i;
+	int ret;
+
+	if (pdata->fd == -1)
+		return -EBADF;
+
+	if (pdata->is_high_speed)
+		disable_high_speed(dev);
+
 	ret = close(pdata->fd);
 	if (ret)
 		return ret;
@@ -1583,12 +2050,28 @@ static int add_scan_elements(struct iio_device *dev, const char *devpath)
 	return 0;
 }
 
-static int create_device(void *d, const char *path)
+static void init_data_scale(struct iio_channel *chn)
+{
+	char buf[1024];
+	ssize_t ret;
+
+	ret = iio_channel_attr_read(chn, "scale", buf, sizeof(buf));
+	if (ret < 0) {
+		chn->format.with_scale = false;
+	} else {
+		chn->format.with_scale = true;
+		chn->format.scale = atof(buf);
+	}
+}
+
+/* Creates the device found in the given sysfs directory, without adding it
+ * to the context; called from several threads at once */
+static int create_device(struct iio_context *ctx, const char *path,
+		struct iio_device **device)
 {
 	uint32_t *mask = NULL;
 	unsigned int i;
 	int ret;
-	struct iio_context *ctx = d;
 	struct iio_device *dev = zalloc(sizeof(*dev));
 	if (!dev)
 		return -ENOMEM;
@@ -1600,6 +2083,8 @@ static int create_device(void *d, const char *path)
 	}
 
 	dev->pdata->fd = -1;
+	dev->pdata->sysfs_fd = -1;
+	dev->pdata->debug_fd = -1;
 	dev->pdata->blocking = true;
 	dev->pdata->nb_blocks = NB_BLOCKS;
 
@@ -1644,9 +2129,11 @@ static int create_device(void *d, const char *path)
 
 	dev->mask = mask;
 
-	ret = add_device_to_context(ctx, dev);
-	if (!ret)
-		return 0;
+	for (i = 0; i < dev->nb_channels; i++)
+		init_data_scale(dev->channels[i]);
+
+	*device = dev;
+	return 0;
 
 err_free_scan_elements:
 	for (i = 0; i < dev->nb_channels; i++)
@@ -1657,6 +2144,157 @@ err_free_device:
 	return ret;
 }
 
+/* The devices of a local context, created in parallel */
+struct device_list {
+	struct iio_context *ctx;
+	char **paths;
+	struct iio_device **devices;
+	int *rets;
+	unsigned int nb;
+
+	/* Protects the fields below */
+	struct iio_mutex *lock;
+	unsigned int next;
+	bool failed;
+};
+
+static int add_device_path(void *d, const char *path)
+{
+	struct device_list *list = d;
+	char **paths, *name = iio_strdup(path);
+	if (!name)
+		return -ENOMEM;
+
+	paths = realloc(list->paths, (list->nb + 1) * sizeof(*paths));
+	if (!paths) {
+		free(name);
+		return -ENOMEM;
+	}
+
+	paths[list->nb++] = name;
+	list->paths = paths;
+	return 0;
+}
+
+/* Creates the devices of the list one after another, in the order of the
+ * directory. After an error, the devices not started yet are skipped: all
+ * the devices before the one that failed have been started already, so the
+ * error reported is always the one of the first device that failed. */
+static void * create_devices_thd(void *d)
+{
+	struct device_list *list = d;
+	unsigned int i;
+
+	for (;;) {
+		iio_mutex_lock(list->lock);
+		i = list->next++;
+		if (list->failed)
+			i = list->nb;
+		iio_mutex_unlock(list->lock);
+
+		if (i >= list->nb)
+			break;
+
+		list->rets[i] = create_device(list->ctx, list->paths[i],
+				&list->devices[i]);
+		if (list->rets[i] < 0) {
+			iio_mutex_lock(list->lock);
+			list->failed = true;
+			iio_mutex_unlock(list->lock);
+		}
+	}
+
+	return NULL;
+}
+
+#ifndef NO_THREADS
+static unsigned int get_nb_threads(unsigned int nb_devices)
+{
+	unsigned int nb = NB_CREATE_THREADS;
+	long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nb_cpus > 0 && (unsigned long) nb_cpus < nb)
+		nb = (unsigned int) nb_cpus;
+
+	return nb < nb_devices ? nb : nb_devices;
+}
+#endif
+
+/* Reading sysfs is slow, but the devices do not depend on each other: they
+ * are created on a few threads, then added to the context in the order of
+ * the directory, so that the context is the same as if they were created
+ * one by one. */
+static int create_devices(struct iio_context *ctx, const char *path)
+{
+	struct device_list list = { .ctx = ctx, };
+	unsigned int i;
+	int ret;
+#ifndef NO_THREADS
+	pthread_t threads[NB_CREATE_THREADS];
+	unsigned int nb_threads, nb_started = 0;
+#endif
+
+	ret = foreach_in_dir(&list, path, true, add_device_path);
+	if (ret < 0 || !list.nb)
+		goto out_free_paths;
+
+	list.devices = calloc(list.nb, sizeof(*list.devices));
+	list.rets = calloc(list.nb, sizeof(*list.rets));
+	list.lock = iio_mutex_create();
+	if (!list.devices || !list.rets || !list.lock) {
+		ret = -ENOMEM;
+		goto out_free_list;
+	}
+
+#ifndef NO_THREADS
+	nb_threads = get_nb_threads(list.nb);
+
+	/* If a thread cannot be started, the others do its share */
+	for (i = 1; i < nb_threads; i++) {
+		if (pthread_create(&threads[nb_started], NULL,
+					create_devices_thd, &list))
+			break;
+		nb_started++;
+	}
+#endif
+
+	create_devices_thd(&list);
+
+#ifndef NO_THREADS
+	for (i = 0; i < nb_started; i++)
+		pthread_join(threads[i], NULL);
+#endif
+
+	for (i = 0; !ret && i < list.nb; i++) {
+		ret = list.rets[i];
+		if (!ret)
+			ret = add_device_to_context(ctx, list.devices[i]);
+		if (!ret)
+			list.devices[i] = NULL;
+	}
+
+	/* Free the devices which were created but not added */
+	for (i = 0; i < list.nb; i++) {
+		struct iio_device *dev = list.devices[i];
+
+		if (dev) {
+			local_free_pdata(dev);
+			free_device(dev);
+		}
+	}
+
+out_free_list:
+	if (list.lock)
+		iio_mutex_destroy(list.lock);
+	free(list.rets);
+	free(list.devices);
+out_free_paths:
+	for (i = 0; i < list.nb; i++)
+		free(list.paths[i]);
+	free(list.paths);
+	return ret;
+}
+
 static int add_debug_attr(void *d, const char *path)
 {
 	struct iio_device *dev = d;
@@ -1710,22 +2348,27 @@ static void local_cancel(const struct iio_device *dev)
 	}
 }
 
-static struct iio_context * local_clone(
-		const struct iio_context *ctx __attribute__((unused)))
+static struct iio_context * create_context(const char *root);
+
+static struct iio_context * local_clone(const struct iio_context *ctx)
 {
-	return local_create_context();
+	return create_context(ctx->pdata->root);
 }
 
 static const struct iio_backend_ops local_ops = {
 	.clone = local_clone,
 	.open = local_open,
 	.close = local_close,
+	.reconfigure = local_reconfigure,
 	.get_fd = local_get_fd,
 	.set_blocking_mode = local_set_blocking_mode,
 	.read = local_read,
+	.read_min = local_read_min,
 	.write = local_write,
 	.set_kernel_buffers_count = local_set_kernel_buffers_count,
 	.get_buffer = local_get_buffer,
+	.dequeue_block = local_dequeue_block,
+	.enqueue_block = local_enqueue_block,
 	.read_device_attr = local_read_dev_attr,
 	.write_device_attr = local_write_dev_attr,
 	.read_channel_attr = local_read_chn_attr,
@@ -1737,32 +2380,6 @@ static const struct iio_backend_ops local_ops = {
 	.cancel = local_cancel,
 };
 
-static void init_data_scale(struct iio_channel *chn)
-{
-	char buf[1024];
-	ssize_t ret;
-
-	ret = iio_channel_attr_read(chn, "scale", buf, sizeof(buf));
-	if (ret < 0) {
-		chn->format.with_scale = false;
-	} else {
-		chn->format.with_scale = true;
-		chn->format.scale = atof(buf);
-	}
-}
-
-static void init_scan_elements(struct iio_context *ctx)
-{
-	unsigned int i, j;
-
-	for (i = 0; i < ctx->nb_devices; i++) {
-		struct iio_device *dev = ctx->devices[i];
-
-		for (j = 0; j < dev->nb_channels; j++)
-			init_data_scale(dev->channels[j]);
-	}
-}
-
 #ifdef WITH_LOCAL_CONFIG
 static int populate_context_attrs(struct iio_context *ctx, const char *file)
 {
@@ -1819,11 +2436,20 @@ out_close_ini:
 }
 #endif
 
-struct iio_context * local_create_context(void)
+/* The prefix set with the IIO_LOCAL_ROOT environment variable, or "" */
+static const char * get_default_root(void)
+{
+	const char *root = getenv("IIO_LOCAL_ROOT");
+
+	return root ? root : "";
+}
+
+static struct iio_context * create_context(const char *root)
 {
 	int ret = -ENOMEM;
 	unsigned int len;
 	struct utsname uts;
+	char buf[1024];
 	struct iio_context *ctx = zalloc(sizeof(*ctx));
 	if (!ctx)
 		goto err_set_errno;
@@ -1837,6 +2463,21 @@ struct iio_context * local_create_context(void)
 		goto err_set_errno;
 	}
 
+	ctx->pdata->root = iio_strdup(root);
+	if (!ctx->pdata->root) {
+		free(ctx->pdata);
+		free(ctx);
+		goto err_set_errno;
+	}
+
+	ctx->pdata->attr_fds_lock = iio_mutex_create();
+	if (!ctx->pdata->attr_fds_lock) {
+		free(ctx->pdata->root);
+		free(ctx->pdata);
+		free(ctx);
+		goto err_set_errno;
+	}
+
 	local_set_timeout(ctx, DEFAULT_TIMEOUT_MS);
 
 	uname(&uts);
@@ -1844,6 +2485,8 @@ struct iio_context * local_create_context(void)
 		+ strlen(uts.version) + strlen(uts.machine);
 	ctx->description = malloc(len + 5); /* 4 spaces + EOF */
 	if (!ctx->description) {
+		iio_mutex_destroy(ctx->pdata->attr_fds_lock);
+		free(ctx->pdata->root);
 		free(ctx->pdata);
 		free(ctx);
 		goto err_set_errno;
@@ -1852,13 +2495,13 @@ struct iio_context * local_create_context(void)
 	iio_snprintf(ctx->description, len + 5, "%s %s %s %s %s", uts.sysname,
 			uts.nodename, uts.release, uts.version, uts.machine);
 
-	ret = foreach_in_dir(ctx, "/sys/bus/iio/devices", true, create_device);
+	iio_snprintf(buf, sizeof(buf), "%s/sys/bus/iio/devices", root);
+	ret = create_devices(ctx, buf);
 	if (ret < 0)
 		goto err_context_destroy;
 
-	foreach_in_dir(ctx, "/sys/kernel/debug/iio", true, add_debug);
-
-	init_scan_elements(ctx);
+	iio_snprintf(buf, sizeof(buf), "%s/sys/kernel/debug/iio", root);
+	foreach_in_dir(ctx, buf, true, add_debug);
 
 #ifdef WITH_LOCAL_CONFIG
 	ret = populate_context_attrs(ctx, "/etc/libiio.ini");
@@ -1870,6 +2513,12 @@ struct iio_context * local_create_context(void)
 	if (ret < 0)
 		goto err_context_destroy;
 
+	if (root[0]) {
+		ret = iio_context_add_attr(ctx, "local,root", root);
+		if (ret < 0)
+			goto err_context_destroy;
+	}
+
 	ret = iio_context_init(ctx);
 	if (ret < 0)
 		goto err_context_destroy;
@@ -1883,6 +2532,26 @@ err_set_errno:
 	return NULL;
 }
 
+struct iio_context * local_create_context(void)
+{
+	return create_context(get_default_root());
+}
+
+struct iio_context * local_create_context_from_uri(const char *uri)
+{
+	const char *params = uri + sizeof("local:") - 1;
+
+	if (!params[0])
+		return local_create_context();
+
+	if (!strncmp(params, "root=", sizeof("root=") - 1) &&
+			params[sizeof("root=") - 1])
+		return create_context(params + sizeof("root=") - 1);
+
+	errno = EINVAL;
+	return NULL;
+}
+
 static int check_device(void *d, const char *path)
 {
 	*(bool *)d = true;
@@ -1893,10 +2562,11 @@ int local_context_scan(struct iio_scan_result *scan_result)
 {
 	struct iio_context_info **info;
 	bool exists = false;
-	char *desc, *uri;
+	char *desc, *uri, buf[1024];
 	int ret;
 
-	ret = foreach_in_dir(&exists, "/sys/bus/iio", true, check_device);
+	iio_snprintf(buf, sizeof(buf), "%s/sys/bus/iio", get_default_root());
+	ret = foreach_in_dir(&exists, buf, true, check_device);
 	if (ret < 0 || !exists)
 		return 0;
 
@@ -756,6 +756,47 @@ out_mutex_unlock:
 	return ret;
 }
 
+/* Re-open the device on the server without closing the socket */
+static int network_reconfigure(const struct iio_device *dev,
+		size_t samples_count)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	int ret = -EBADF;
+
+	iio_mutex_lock(pdata->lock);
+
+	if (pdata->io_ctx.fd < 0 || pdata->io_ctx.cancelled)
+		goto out_mutex_unlock;
+
+	ret = iiod_client_close_unlocked(dev->ctx->pdata->iiod_client,
+			&pdata->io_ctx, dev);
+	if (ret < 0)
+		goto out_mutex_unlock;
+
+	ret = iiod_client_open_unlocked(dev->ctx->pdata->iiod_client,
+			&pdata->io_ctx, dev, samples_count, pdata->is_cyclic);
+	if (ret < 0)
+		goto out_mutex_unlock;
+
+	pdata->wait_for_err_code = false;
+#ifdef WITH_NETWORK_GET_BUFFER
+	if (pdata->memfd >= 0)
+		close(pdata->memfd);
+	pdata->memfd = -1;
+
+	if (pdata->mmap_addr) {
+		munmap(pdata->mmap_addr, pdata->mmap_len);
+		pdata->mmap_addr = NULL;
+	}
+
+	pdata->mmap_len = samples_count * iio_device_get_sample_size(dev);
+#endif
+
+out_mutex_unlock:
+	iio_mutex_unlock(pdata->lock);
+	return ret;
+}
+
 static int network_close(const struct iio_device *dev)
 {
 	struct iio_device_pdata *pdata = dev->pdata;
@@ -808,6 +849,36 @@ static ssize_t network_read(const struct iio_device *dev, void *dst, size_t len,
 	return ret;
 }
 
+static ssize_t network_read_min(const struct iio_device *dev, void *dst,
+		size_t len, size_t min_len, uint32_t *mask, size_t words)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	ssize_t ret;
+
+	/* The samples pending on the server cannot be known: read exactly
+	 * the minimum */
+	iio_mutex_lock(pdata->lock);
+	ret = iiod_client_read_partial_unlocked(dev->ctx->pdata->iiod_client,
+			&pdata->io_ctx, dev, dst, min_len, mask, words);
+	iio_mutex_unlock(pdata->lock);
+
+	return ret;
+}
+
+static ssize_t network_read_stats(const struct iio_device *dev, size_t len,
+		uint32_t *mask, size_t words, struct iio_channel_stats *stats)
+{
+	struct iio_device_pdata *pdata = dev->pdata;
+	ssize_t ret;
+
+	iio_mutex_lock(pdata->lock);
+	ret = iiod_client_read_stats_unlocked(dev->ctx->pdata->iiod_client,
+			&pdata->io_ctx, dev, len, mask, words, stats);
+	iio_mutex_unlock(pdata->lock);
+
+	return ret;
+}
+
 static ssize_t network_write(const struct iio_device *dev,
 		const void *src, size_t len)
 {
@@ -1265,7 +1336,10 @@ static const struct iio_backend_ops network_ops = {
 	.clone = network_clone,
 	.open = network_open,
 	.close = network_close,
+	.reconfigure = network_reconfigure,
 	.read = network_read,
+	.read_min = network_read_min,
+	.read_stats = network_read_stats,
 	.write = network_write,
 #ifdef WITH_NETWORK_GET_BUFFER
 	.get_buffer = network_get_buffer,
@@ -1553,6 +1627,8 @@ struct iio_context * network_create_context(const char *host)
 
 	iiod_client_set_timeout(pdata->iiod_client, &pdata->io_ctx,
 			calculate_remote_timeout(DEFAULT_TIMEOUT_MS));
+
+	iio_context_init_scales(ctx);
 	return ctx;
 
 err_free_description:
@@ -397,6 +397,7 @@ static struct iio_context * serial_create_context(const char *port_name,
 		}
 	}
 
+	iio_context_init_scales(ctx);
 	return ctx;
 
 err_context_destroy:
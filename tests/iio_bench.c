@@ -0,0 +1,992 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include <errno.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <iio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || \
+		(__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define HAS_MALLINFO2 1
+#endif
+
+#define MY_NAME "iio_bench"
+
+#define DEFAULT_ITERATIONS 1000
+#define DEFAULT_SAMPLES 4096
+
+static const struct option options[] = {
+	  {"help", no_argument, 0, 'h'},
+	  {"benchmark", required_argument, 0, 'b'},
+	  {"iterations", required_argument, 0, 'i'},
+	  {"samples", required_argument, 0, 's'},
+	  {0, 0, 0, 0},
+};
+
+static const char *options_descriptions[] = {
+	"Show this help and quit.",
+	"Benchmark to run. Default is \"layout\".",
+	"Number of iterations. Default is 1000.",
+	"Number of samples per buffer. Default is 4096.",
+};
+
+static void usage(void)
+{
+	unsigned int i;
+
+	printf("Usage:\n\t" MY_NAME " [-b <benchmark>] [-i <iterations>] "
+			"[-s <samples>] <xml_file|uri> [<xml_file|uri> ...]\n\n"
+			"Benchmarks:\n"
+			"\tlayout\t\tChannel lookup: per-call walk vs. iio_buffer_first/foreach_sample\n"
+			"\tunpack\t\tChannel conversion: per-sample vs. bulk unpacking\n"
+			"\tattr\t\tAttribute reads: stdio vs. the backend (\"local:\" only)\n"
+			"\tcontext\t\tContext creation: time and heap usage\n"
+			"\nOptions:\n");
+	for (i = 0; options[i].name; i++)
+		printf("\t-%c, --%s\n\t\t\t%s\n",
+					options[i].val, options[i].name,
+					options_descriptions[i]);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const char * device_name(const struct iio_device *dev)
+{
+	const char *name = iio_device_get_name(dev);
+
+	return name ? name : iio_device_get_id(dev);
+}
+
+static unsigned int enable_scan_channels(struct iio_device *dev)
+{
+	unsigned int i, nb = 0;
+
+	for (i = 0; i < iio_device_get_channels_count(dev); i++) {
+		struct iio_channel *chn = iio_device_get_channel(dev, i);
+
+		if (iio_channel_is_scan_element(chn)) {
+			iio_channel_enable(chn);
+			nb++;
+		}
+	}
+
+	return nb;
+}
+
+static void format_string(const struct iio_data_format *fmt,
+		char *str, size_t len)
+{
+	char repeat[12] = "";
+
+	if (fmt->repeat > 1)
+		snprintf(repeat, sizeof(repeat), "X%u", fmt->repeat);
+
+	snprintf(str, len, "%s:%c%u/%u%s>>%u", fmt->is_be ? "be" : "le",
+			fmt->is_signed ? 's' : 'u', fmt->bits, fmt->length,
+			repeat, fmt->shift);
+}
+
+/* Offset of the first sample of a channel, computed the way
+ * iio_buffer_first() used to: by walking all the channels that precede it. */
+static size_t walk_first(const struct iio_device *dev,
+		const struct iio_channel *chn)
+{
+	unsigned int i, nb = iio_device_get_channels_count(dev);
+	long index = iio_channel_get_index(chn);
+	const struct iio_data_format *fmt;
+	size_t ptr = 0, len;
+
+	for (i = 0; i < nb; i++) {
+		const struct iio_channel *cur = iio_device_get_channel(dev, i);
+		long cur_index = iio_channel_get_index(cur);
+
+		fmt = iio_channel_get_data_format(cur);
+		len = fmt->length / 8 * fmt->repeat;
+
+		if (cur_index < 0 || cur_index == index)
+			break;
+		if (!iio_channel_is_enabled(cur))
+			continue;
+		if (i > 0 && cur_index == iio_channel_get_index(
+					iio_device_get_channel(dev, i - 1)))
+			continue;
+
+		if (len && ptr % len)
+			ptr += len - (ptr % len);
+		ptr += len;
+	}
+
+	len = iio_channel_get_data_format(chn)->length / 8;
+	if (len && ptr % len)
+		ptr += len - (ptr % len);
+	return ptr;
+}
+
+/* Calls the callback on every sample, the way iio_buffer_foreach_sample()
+ * used to: by walking the channel list again for each sample. */
+static ssize_t walk_foreach(const struct iio_device *dev,
+		uintptr_t start, uintptr_t end, size_t step,
+		ssize_t (*callback)(const struct iio_channel *,
+			void *, size_t, void *), void *d)
+{
+	unsigned int i, nb = iio_device_get_channels_count(dev);
+	uintptr_t ptr = start;
+	ssize_t processed = 0;
+
+	while (end - ptr >= step) {
+		for (i = 0; i < nb; i++) {
+			const struct iio_channel *chn =
+				iio_device_get_channel(dev, i);
+			const struct iio_data_format *fmt =
+				iio_channel_get_data_format(chn);
+			unsigned int length = fmt->length / 8;
+			long index = iio_channel_get_index(chn);
+			ssize_t ret;
+
+			if (index < 0)
+				break;
+			if (!iio_channel_is_enabled(chn))
+				continue;
+
+			if ((ptr - start) % length)
+				ptr += length - ((ptr - start) % length);
+
+			ret = callback(chn, (void *) ptr, length, d);
+			if (ret < 0)
+				return ret;
+			processed += ret;
+
+			if (i == nb - 1 || index != iio_channel_get_index(
+					iio_device_get_channel(dev, i + 1)))
+				ptr += length * fmt->repeat;
+		}
+	}
+
+	return processed;
+}
+
+static ssize_t copy_sample(const struct iio_channel *chn,
+		void *src, size_t len, void *d)
+{
+	memcpy(d, src, len);
+	return (ssize_t) len;
+}
+
+static size_t demux(const struct iio_channel *chn, const uint8_t *src,
+		const uint8_t *end, size_t step, uint8_t *dst)
+{
+	const struct iio_data_format *fmt = iio_channel_get_data_format(chn);
+	size_t length = fmt->length / 8 * fmt->repeat;
+	uint8_t *ptr = dst;
+
+	for (; src + length <= end; src += step, ptr += length)
+		memcpy(ptr, src, length);
+	return ptr - dst;
+}
+
+/* XML contexts cannot create buffers. Their devices are copied into a
+ * minimal sysfs tree, which a local context opens with "local:root=". */
+#define MIRROR_DEVICE "/sys/bus/iio/devices/iio:device0"
+
+static const char * const mirror_dirs[] = {
+	"/sys",
+	"/sys/bus",
+	"/sys/bus/iio",
+	"/sys/bus/iio/devices",
+	MIRROR_DEVICE,
+	MIRROR_DEVICE "/buffer",
+	MIRROR_DEVICE "/scan_elements",
+	"/dev",
+};
+
+static int mirror_file(const char *root, const char *name,
+		const char *value)
+{
+	char path[PATH_MAX];
+	FILE *f;
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s%s", root, name);
+	if (ret < 0 || (size_t) ret >= sizeof(path))
+		return -ENAMETOOLONG;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	/* Like sysfs, every value ends with a newline */
+	ret = fprintf(f, "%s\n", value);
+	if (fclose(f) || ret < 0)
+		return -EIO;
+	return 0;
+}
+
+static int mirror_device(const struct iio_device *dev, const char *root)
+{
+	unsigned int i, nb = iio_device_get_channels_count(dev);
+	char path[PATH_MAX], name[128], value[64];
+	long last_index = -1;
+	int ret;
+
+	for (i = 0; i < sizeof(mirror_dirs) / sizeof(*mirror_dirs); i++) {
+		ret = snprintf(path, sizeof(path), "%s%s",
+				root, mirror_dirs[i]);
+		if (ret < 0 || (size_t) ret >= sizeof(path))
+			return -ENAMETOOLONG;
+		if (mkdir(path, 0755) < 0)
+			return -errno;
+	}
+
+	ret = mirror_file(root, MIRROR_DEVICE "/name", device_name(dev));
+	if (!ret)
+		ret = mirror_file(root, MIRROR_DEVICE "/buffer/enable", "0");
+	if (!ret)
+		ret = mirror_file(root, MIRROR_DEVICE "/buffer/length", "0");
+	if (!ret)
+		ret = mirror_file(root, "/dev/iio:device0", "");
+
+	for (i = 0; !ret && i < nb; i++) {
+		const struct iio_channel *chn = iio_device_get_channel(dev, i);
+		long index = iio_channel_get_index(chn);
+		char prefix[64];
+
+		/* Channels sharing an index share their samples too */
+		if (!iio_channel_is_scan_element(chn) || index == last_index)
+			continue;
+		last_index = index;
+
+		if (iio_channel_get_type(chn) == IIO_TIMESTAMP)
+			snprintf(prefix, sizeof(prefix), "%s_timestamp",
+					iio_channel_is_output(chn) ?
+					"out" : "in");
+		else
+			snprintf(prefix, sizeof(prefix), "%s_voltage%ld",
+					iio_channel_is_output(chn) ?
+					"out" : "in", index);
+
+		snprintf(name, sizeof(name), MIRROR_DEVICE
+				"/scan_elements/%s_en", prefix);
+		ret = mirror_file(root, name, "0");
+		if (ret < 0)
+			break;
+
+		snprintf(name, sizeof(name), MIRROR_DEVICE
+				"/scan_elements/%s_index", prefix);
+		snprintf(value, sizeof(value), "%ld", index);
+		ret = mirror_file(root, name, value);
+		if (ret < 0)
+			break;
+
+		snprintf(name, sizeof(name), MIRROR_DEVICE
+				"/scan_elements/%s_type", prefix);
+		format_string(iio_channel_get_data_format(chn),
+				value, sizeof(value));
+		ret = mirror_file(root, name, value);
+	}
+
+	return ret;
+}
+
+static int remove_entry(const char *path, const struct stat *st,
+		int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+/* Times iio_buffer_first() and iio_buffer_foreach_sample() against the
+ * channel walks they replaced, on a buffer of the device. */
+static int bench_layout_buffer(struct iio_device *dev,
+		unsigned int iterations, size_t samples)
+{
+	unsigned int i, j, nb = iio_device_get_channels_count(dev);
+	double start, walk, table, walk_each, table_each;
+	struct iio_buffer *buf;
+	uint8_t *dst, *first, *end, scratch[64];
+	size_t max_length = 0;
+	ptrdiff_t step;
+	int ret = 0;
+
+	for (j = 0; j < nb; j++) {
+		const struct iio_data_format *fmt = iio_channel_get_data_format(
+				iio_device_get_channel(dev, j));
+
+		if (fmt->length / 8 * fmt->repeat > max_length)
+			max_length = fmt->length / 8 * fmt->repeat;
+	}
+
+	buf = iio_device_create_buffer(dev, samples, false);
+	if (!buf)
+		return -errno;
+
+	first = iio_buffer_start(buf);
+	end = iio_buffer_end(buf);
+	step = iio_buffer_step(buf);
+
+	/* Holds the samples of any one channel */
+	dst = malloc(samples * max_length);
+	if (!dst) {
+		ret = -ENOMEM;
+		goto out_destroy_buffer;
+	}
+
+	for (j = 0; j < nb; j++) {
+		const struct iio_channel *chn = iio_device_get_channel(dev, j);
+
+		if (iio_channel_is_enabled(chn) && first + walk_first(dev, chn) !=
+				(uint8_t *) iio_buffer_first(buf, chn)) {
+			fprintf(stderr, "%s: wrong offset for channel %s\n",
+					device_name(dev),
+					iio_channel_get_id(chn));
+			ret = -EIO;
+			goto out_free_dst;
+		}
+	}
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < nb; j++) {
+			const struct iio_channel *chn =
+				iio_device_get_channel(dev, j);
+
+			if (iio_channel_is_enabled(chn))
+				demux(chn, first + walk_first(dev, chn),
+						end, step, dst);
+		}
+	}
+	walk = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < nb; j++) {
+			const struct iio_channel *chn =
+				iio_device_get_channel(dev, j);
+
+			if (iio_channel_is_enabled(chn))
+				demux(chn, iio_buffer_first(buf, chn),
+						end, step, dst);
+		}
+	}
+	table = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++)
+		walk_foreach(dev, (uintptr_t) first, (uintptr_t) end,
+				step, copy_sample, scratch);
+	walk_each = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++)
+		iio_buffer_foreach_sample(buf, copy_sample, scratch);
+	table_each = (now_ns() - start) / iterations;
+
+	printf("\t%-20s %3u channels  first: walk %10.0f ns  "
+			"iio_buffer_first %10.0f ns  (x%.2f)\n",
+			device_name(dev), nb, walk, table, walk / table);
+	printf("\t%-20s %3u channels  foreach: walk %10.0f ns  "
+			"iio_buffer_foreach_sample %10.0f ns  (x%.2f)\n",
+			device_name(dev), nb, walk_each, table_each,
+			walk_each / table_each);
+
+out_free_dst:
+	free(dst);
+out_destroy_buffer:
+	iio_buffer_destroy(buf);
+	return ret;
+}
+
+static int bench_layout(struct iio_device *dev, unsigned int iterations,
+		size_t samples)
+{
+	char root[] = "/tmp/iio_bench.XXXXXX", uri[sizeof(root) + 16];
+	struct iio_context *ctx;
+	unsigned int i;
+	int ret;
+
+	if (strcmp(iio_context_get_name(iio_device_get_context(dev)), "xml"))
+		return bench_layout_buffer(dev, iterations, samples);
+
+	if (!mkdtemp(root))
+		return -errno;
+
+	ret = mirror_device(dev, root);
+	if (ret < 0)
+		goto out_remove_root;
+
+	snprintf(uri, sizeof(uri), "local:root=%s", root);
+	ctx = iio_create_context_from_uri(uri);
+	if (!ctx) {
+		ret = -errno;
+		goto out_remove_root;
+	}
+
+	dev = iio_context_get_device(ctx, 0);
+	for (i = 0; i < iio_device_get_channels_count(dev); i++)
+		iio_channel_enable(iio_device_get_channel(dev, i));
+
+	ret = bench_layout_buffer(dev, iterations, samples);
+	iio_context_destroy(ctx);
+
+out_remove_root:
+	nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	return ret;
+}
+
+/* Converts one sample the way iio_channel_convert() used to: byte per byte,
+ * with a byte swap, a shift then a sign extension or a mask of the unused
+ * bits. Kept, with its big-endian paths completed, as the reference the
+ * conversions of the library are checked against. */
+static void ref_byte_swap(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = src[len - i - 1];
+}
+
+static void ref_shift_bits(uint8_t *dst, size_t shift, size_t len)
+{
+	size_t i, shift_bytes = shift / 8;
+
+	shift %= 8;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (shift_bytes) {
+		memmove(dst, dst + shift_bytes, len - shift_bytes);
+		memset(dst + len - shift_bytes, 0, shift_bytes);
+	}
+	if (shift) {
+		for (i = 0; i < len; i++) {
+			dst[i] >>= shift;
+			if (i < len - 1)
+				dst[i] |= dst[i + 1] << (8 - shift);
+		}
+	}
+#else
+	if (shift_bytes) {
+		memmove(dst + shift_bytes, dst, len - shift_bytes);
+		memset(dst, 0, shift_bytes);
+	}
+	if (shift) {
+		for (i = len; i > 0; i--) {
+			dst[i - 1] >>= shift;
+			if (i > 1)
+				dst[i - 1] |= dst[i - 2] << (8 - shift);
+		}
+	}
+#endif
+}
+
+static void ref_sign_extend(uint8_t *dst, size_t bits, size_t len)
+{
+	size_t upper_bytes = ((len * 8 - bits) / 8);
+	uint8_t msb, msb_bit = 1 << ((bits - 1) % 8);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	msb = dst[len - 1 - upper_bytes] & msb_bit;
+	if (upper_bytes)
+		memset(dst + len - upper_bytes, msb ? 0xff : 0x00, upper_bytes);
+	if (msb)
+		dst[len - 1 - upper_bytes] |= ~(msb_bit - 1);
+	else
+		dst[len - 1 - upper_bytes] &= (msb_bit - 1);
+#else
+	msb = dst[upper_bytes] & msb_bit;
+	if (upper_bytes)
+		memset(dst, msb ? 0xff : 0x00, upper_bytes);
+	if (msb)
+		dst[upper_bytes] |= ~(msb_bit - 1);
+	else
+		dst[upper_bytes] &= (msb_bit - 1);
+#endif
+}
+
+static void ref_mask_upper_bits(uint8_t *dst, size_t bits, size_t len)
+{
+	size_t i;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	if (bits % 8)
+		dst[bits / 8] &= (1 << (bits % 8)) - 1;
+	for (i = (bits + 7) / 8; i < len; i++)
+		dst[i] = 0;
+#else
+	if (bits % 8)
+		dst[len - 1 - bits / 8] &= (1 << (bits % 8)) - 1;
+	for (i = (bits + 7) / 8; i < len; i++)
+		dst[len - 1 - i] = 0;
+#endif
+}
+
+static void ref_convert(const struct iio_data_format *fmt,
+		uint8_t *dst, const uint8_t *src)
+{
+	size_t len = fmt->length / 8;
+	unsigned int k;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	bool swap = fmt->is_be;
+#else
+	bool swap = !fmt->is_be;
+#endif
+
+	for (k = 0; k < fmt->repeat; k++, src += len, dst += len) {
+		if (len == 1 || !swap)
+			memcpy(dst, src, len);
+		else
+			ref_byte_swap(dst, src, len);
+
+		if (fmt->shift)
+			ref_shift_bits(dst, fmt->shift, len);
+
+		if (!fmt->is_fully_defined) {
+			if (fmt->is_signed)
+				ref_sign_extend(dst, fmt->bits, len);
+			else
+				ref_mask_upper_bits(dst, fmt->bits, len);
+		}
+	}
+}
+
+/* Converts the samples of one channel, with one array per repeated element:
+ * with iio_channel_convert() one sample at a time, then in bulk with
+ * iio_channel_unpack(). The results of both are checked against
+ * ref_convert(). */
+static int bench_unpack_channel(const struct iio_device *dev,
+		const struct iio_channel *chn, const uint8_t *buf,
+		unsigned int iterations, size_t samples)
+{
+	const struct iio_data_format *fmt = iio_channel_get_data_format(chn);
+	ssize_t step = iio_device_get_sample_size(dev);
+	size_t width = fmt->length / 8, length = width * fmt->repeat;
+	const uint8_t *src = buf + walk_first(dev, chn);
+	uint8_t *tmp, *ref, *conv, *out;
+	double start, per_sample, unpack;
+	unsigned int i, k;
+	void **dsts;
+	char str[32];
+	size_t j;
+	int ret = 0;
+
+	tmp = malloc(length);
+	ref = malloc(samples * length);
+	conv = malloc(samples * length);
+	out = malloc(samples * length);
+	dsts = malloc(fmt->repeat * sizeof(*dsts));
+	if (!tmp || !ref || !conv || !out || !dsts) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (k = 0; k < fmt->repeat; k++)
+		dsts[k] = out + k * samples * width;
+
+	for (j = 0; j < samples; j++) {
+		ref_convert(fmt, tmp, src + j * step);
+		for (k = 0; k < fmt->repeat; k++)
+			memcpy(ref + (k * samples + j) * width,
+					tmp + k * width, width);
+	}
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < samples; j++) {
+			iio_channel_convert(chn, tmp, src + j * step);
+			for (k = 0; k < fmt->repeat; k++)
+				memcpy(conv + (k * samples + j) * width,
+						tmp + k * width, width);
+		}
+	}
+	per_sample = (now_ns() - start) / iterations;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		ret = (int) iio_channel_unpack(chn, dsts, src, step, samples);
+		if (ret < 0)
+			goto out_free;
+	}
+	unpack = (now_ns() - start) / iterations;
+
+	format_string(fmt, str, sizeof(str));
+
+	if (memcmp(ref, conv, samples * length) ||
+			memcmp(ref, out, samples * length)) {
+		fprintf(stderr, "%s: %s: results differ from the reference\n",
+				device_name(dev), iio_channel_get_id(chn));
+		ret = -EIO;
+		goto out_free;
+	}
+
+	printf("\t%-20s %-16s %-16s per-sample %10.0f ns  "
+			"unpack %10.0f ns  (x%.2f)\n", device_name(dev),
+			iio_channel_get_id(chn), str,
+			per_sample, unpack, per_sample / unpack);
+	ret = 0;
+
+out_free:
+	free(dsts);
+	free(out);
+	free(conv);
+	free(ref);
+	free(tmp);
+	return ret;
+}
+
+static int bench_unpack(struct iio_device *dev, unsigned int iterations,
+		size_t samples)
+{
+	unsigned int i, nb = iio_device_get_channels_count(dev);
+	ssize_t step = iio_device_get_sample_size(dev);
+	uint8_t *buf;
+	size_t j;
+	int ret = 0;
+
+	if (step <= 0)
+		return 0;
+
+	buf = malloc(samples * step);
+	if (!buf)
+		return -ENOMEM;
+
+	/* Random samples, so that the sign extension and the masking of the
+	 * unused bits are exercised */
+	srand(0);
+	for (j = 0; j < samples * step; j++)
+		buf[j] = (uint8_t) rand();
+
+	for (i = 0; !ret && i < nb; i++) {
+		const struct iio_channel *chn = iio_device_get_channel(dev, i);
+
+		if (iio_channel_is_enabled(chn))
+			ret = bench_unpack_channel(dev, chn, buf,
+					iterations, samples);
+	}
+
+	free(buf);
+	return ret;
+}
+
+/* Reads an attribute file the way the local backend used to: the path is
+ * built for every access, then read through stdio */
+static ssize_t stdio_read(const char *path, char *dst, size_t len)
+{
+	FILE *f = fopen(path, "re");
+	ssize_t ret;
+
+	if (!f)
+		return -errno;
+
+	ret = (ssize_t) fread(dst, 1, len, f);
+	fclose(f);
+	return ret;
+}
+
+struct bench_attr {
+	const struct iio_channel *chn;
+	const char *name;
+};
+
+static int bench_attr(struct iio_device *dev, unsigned int iterations,
+		size_t samples)
+{
+	const struct iio_context *ctx = iio_device_get_context(dev);
+	unsigned int i, j, nb = 0, nb_attrs = iio_device_get_attrs_count(dev);
+	double start, stdio, cached;
+	struct bench_attr *attrs;
+	char buf[1024], path[1024];
+	const char *root;
+
+	if (strcmp(iio_context_get_name(ctx), "local")) {
+		printf("\t%-20s not a local context, skipped\n",
+				device_name(dev));
+		return 0;
+	}
+
+	/* Set when the context was created with "local:root=" */
+	root = iio_context_get_attr_value(ctx, "local,root");
+	if (!root)
+		root = "";
+
+	for (i = 0; i < iio_device_get_channels_count(dev); i++)
+		nb_attrs += iio_channel_get_attrs_count(
+				iio_device_get_channel(dev, i));
+
+	attrs = calloc(nb_attrs, sizeof(*attrs));
+	if (!attrs)
+		return -ENOMEM;
+
+	/* Only the attributes that can be read are timed */
+	for (i = 0; i < iio_device_get_attrs_count(dev); i++) {
+		const char *name = iio_device_get_attr(dev, i);
+
+		if (iio_device_attr_read(dev, name, buf, sizeof(buf)) > 0)
+			attrs[nb++].name = name;
+	}
+
+	for (i = 0; i < iio_device_get_channels_count(dev); i++) {
+		const struct iio_channel *chn = iio_device_get_channel(dev, i);
+
+		for (j = 0; j < iio_channel_get_attrs_count(chn); j++) {
+			const char *name = iio_channel_get_attr(chn, j);
+
+			if (iio_channel_attr_read(chn, name,
+						buf, sizeof(buf)) > 0) {
+				attrs[nb].chn = chn;
+				attrs[nb++].name = name;
+			}
+		}
+	}
+
+	if (!nb) {
+		printf("\t%-20s no readable attributes, skipped\n",
+				device_name(dev));
+		free(attrs);
+		return 0;
+	}
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < nb; j++) {
+			const char *fn = attrs[j].chn ?
+				iio_channel_attr_get_filename(attrs[j].chn,
+						attrs[j].name) : attrs[j].name;
+
+			snprintf(path, sizeof(path),
+					"%s/sys/bus/iio/devices/%s/%s", root,
+					iio_device_get_id(dev), fn);
+			stdio_read(path, buf, sizeof(buf));
+		}
+	}
+	stdio = (double) nb * iterations * 1e9 / (now_ns() - start);
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < nb; j++) {
+			if (attrs[j].chn)
+				iio_channel_attr_read(attrs[j].chn,
+						attrs[j].name, buf, sizeof(buf));
+			else
+				iio_device_attr_read(dev, attrs[j].name,
+						buf, sizeof(buf));
+		}
+	}
+	cached = (double) nb * iterations * 1e9 / (now_ns() - start);
+
+	printf("\t%-20s %3u attributes  stdio %10.0f ops/s  "
+			"backend %10.0f ops/s  (x%.2f)\n", device_name(dev),
+			nb, stdio, cached, cached / stdio);
+
+	free(attrs);
+	return 0;
+}
+
+static struct iio_context * create_context(const char *arg)
+{
+	if (!strncmp(arg, "local:", 6) || !strncmp(arg, "ip:", 3) ||
+			!strncmp(arg, "usb:", 4) ||
+			!strncmp(arg, "xml:", 4))
+		return iio_create_context_from_uri(arg);
+	else
+		return iio_create_xml_context(arg);
+}
+
+/* Bytes currently allocated on the heap, or 0 if unknown */
+static size_t heap_usage(void)
+{
+#ifdef HAS_MALLINFO2
+	struct mallinfo2 mi = mallinfo2();
+
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static int bench_context(const char *arg, unsigned int iterations)
+{
+	unsigned int i, j, nb_channels = 0, nb_attrs = 0;
+	double start, elapsed, total = 0.0, best = 0.0;
+	size_t heap_before, heap = 0;
+	struct iio_context *ctx;
+
+	for (i = 0; i < iterations; i++) {
+		heap_before = heap_usage();
+		start = now_ns();
+
+		ctx = create_context(arg);
+		if (!ctx)
+			return -errno;
+
+		elapsed = now_ns() - start;
+		total += elapsed;
+		if (!i || elapsed < best)
+			best = elapsed;
+
+		/* The first context tells the size of the tree */
+		if (!i) {
+			heap = heap_usage() - heap_before;
+
+			for (j = 0; j < iio_context_get_devices_count(ctx);
+					j++) {
+				const struct iio_device *dev =
+					iio_context_get_device(ctx, j);
+				unsigned int k;
+
+				nb_attrs += iio_device_get_attrs_count(dev);
+				nb_channels += iio_device_get_channels_count(dev);
+
+				for (k = 0; k < iio_device_get_channels_count(
+							dev); k++)
+					nb_attrs += iio_channel_get_attrs_count(
+						iio_device_get_channel(dev, k));
+			}
+
+			printf("\t%u devices, %u channels, %u attributes\n",
+					iio_context_get_devices_count(ctx),
+					nb_channels, nb_attrs);
+		}
+
+		iio_context_destroy(ctx);
+	}
+
+	printf("\tcreation  mean %10.3f ms  min %10.3f ms\n",
+			total / iterations / 1e6, best / 1e6);
+	if (heap)
+		printf("\theap      %10zu bytes\n", heap);
+	return 0;
+}
+
+static const struct benchmark {
+	const char *name;
+	int (*run)(struct iio_device *dev, unsigned int iterations,
+			size_t samples);
+	bool needs_scan_elements;
+
+	/* Set for benchmarks which run once per context rather than once
+	 * per device */
+	int (*run_context)(const char *arg, unsigned int iterations);
+} benchmarks[] = {
+	{ "layout", bench_layout, true, NULL },
+	{ "unpack", bench_unpack, true, NULL },
+	{ "attr", bench_attr, false, NULL },
+	{ "context", NULL, false, bench_context },
+};
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations = DEFAULT_ITERATIONS;
+	size_t samples = DEFAULT_SAMPLES;
+	const char *benchmark = "layout";
+	const struct benchmark *bench = NULL;
+	unsigned int i;
+	int c, option_index = 0, ret = 0;
+
+	while ((c = getopt_long(argc, argv, "+hb:i:s:",
+					options, &option_index)) != -1) {
+		switch (c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case 'b':
+			benchmark = optarg;
+			break;
+		case 'i':
+			iterations = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			samples = (size_t) strtoul(optarg, NULL, 10);
+			break;
+		case '?':
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || !iterations || !samples) {
+		fprintf(stderr, "Incorrect number of arguments.\n\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); i++) {
+		if (!strcmp(benchmark, benchmarks[i].name))
+			bench = &benchmarks[i];
+	}
+
+	if (!bench) {
+		fprintf(stderr, "Unknown benchmark: %s\n", benchmark);
+		return EXIT_FAILURE;
+	}
+
+	for (; optind < argc && !ret; optind++) {
+		const char *arg = argv[optind];
+		struct iio_context *ctx;
+
+		if (bench->run_context) {
+			printf("%s:\n", arg);
+			ret = bench->run_context(arg, iterations);
+			continue;
+		}
+
+		ctx = create_context(arg);
+		if (!ctx) {
+			fprintf(stderr, "Unable to create context from %s\n",
+					argv[optind]);
+			return EXIT_FAILURE;
+		}
+
+		printf("%s:\n", argv[optind]);
+
+		for (i = 0; !ret && i < iio_context_get_devices_count(ctx);
+				i++) {
+			struct iio_device *dev =
+				iio_context_get_device(ctx, i);
+
+			if (!enable_scan_channels(dev) &&
+					bench->needs_scan_elements)
+				printf("\t%-20s no scan elements, skipped\n",
+						device_name(dev));
+			else
+				ret = bench->run(dev, iterations, samples);
+		}
+
+		iio_context_destroy(ctx);
+	}
+
+	if (ret < 0) {
+		char err_str[1024];
+
+		iio_strerror(-ret, err_str, sizeof(err_str));
+		fprintf(stderr, "Benchmark failed: %s\n", err_str);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
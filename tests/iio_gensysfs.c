@@ -0,0 +1,278 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MY_NAME "iio_gensysfs"
+
+#define DEFAULT_DEVICES 4
+#define DEFAULT_CHANNELS 8
+#define DEFAULT_ATTRIBUTES 4
+
+static const struct option options[] = {
+	  {"help", no_argument, 0, 'h'},
+	  {"devices", required_argument, 0, 'd'},
+	  {"channels", required_argument, 0, 'c'},
+	  {"attributes", required_argument, 0, 'a'},
+	  {0, 0, 0, 0},
+};
+
+static const char *options_descriptions[] = {
+	"Show this help and quit.",
+	"Number of devices. Default is 4.",
+	"Number of channels per device. Default is 8.",
+	"Number of attributes per channel. Default is 4.",
+};
+
+/* Names given to the first attributes of each channel */
+static const char * const channel_attrs[] = {
+	"raw",
+	"scale",
+	"offset",
+	"calibbias",
+	"calibscale",
+	"hardwaregain",
+	"sampling_frequency",
+	"filter_low_pass_3db_frequency",
+};
+
+/* Subdirectories of each device */
+static const char * const device_dirs[] = {
+	"scan_elements",
+	"buffer",
+	"trigger",
+};
+
+static void usage(void)
+{
+	unsigned int i;
+
+	printf("Usage:\n\t" MY_NAME " [-d <devices>] [-c <channels>] "
+			"[-a <attributes>] <root>\n\n"
+			"Creates a synthetic IIO tree in <root>/sys/bus/iio/devices, "
+			"to be used with\nthe URI \"local:root=<root>\".\n"
+			"\nOptions:\n");
+	for (i = 0; options[i].name; i++)
+		printf("\t-%c, --%s\n\t\t\t%s\n",
+					options[i].val, options[i].name,
+					options_descriptions[i]);
+}
+
+/* Creates the directory and its parents, like "mkdir -p" */
+static int make_dirs(const char *path)
+{
+	char buf[4096], *ptr;
+
+	snprintf(buf, sizeof(buf), "%s", path);
+
+	for (ptr = buf + 1; ; ptr++) {
+		char c = *ptr;
+
+		if (c != '/' && c != '\0')
+			continue;
+
+		*ptr = '\0';
+		if (mkdir(buf, 0755) < 0 && errno != EEXIST)
+			return -errno;
+		*ptr = c;
+
+		if (c == '\0')
+			return 0;
+	}
+}
+
+/* Writes "<dir>/<name>" into 'dst', failing instead of truncating */
+static int join_path(char *dst, size_t len, const char *dir, const char *name)
+{
+	int ret = snprintf(dst, len, "%s/%s", dir, name);
+
+	if (ret < 0 || (size_t) ret >= len)
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+static int write_file(const char *dir, const char *name,
+		const char *fmt, ...)
+{
+	char path[4096];
+	va_list ap;
+	FILE *f;
+	int ret;
+
+	ret = join_path(path, sizeof(path), dir, name);
+	if (ret < 0)
+		return ret;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+
+	va_start(ap, fmt);
+	ret = vfprintf(f, fmt, ap);
+	va_end(ap);
+
+	if (fclose(f) || ret < 0)
+		return -EIO;
+	return 0;
+}
+
+static int create_channel(const char *dir, unsigned int index,
+		unsigned int nb_attrs)
+{
+	char name[64], scan_dir[4096];
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < nb_attrs; i++) {
+		if (i < sizeof(channel_attrs) / sizeof(*channel_attrs))
+			snprintf(name, sizeof(name), "in_voltage%u_%s",
+					index, channel_attrs[i]);
+		else
+			snprintf(name, sizeof(name), "in_voltage%u_attr%u",
+					index, i);
+
+		/* The scale is read when the context is created */
+		if (i == 1)
+			ret = write_file(dir, name, "0.250000\n");
+		else
+			ret = write_file(dir, name, "%u\n", index * 100 + i);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = join_path(scan_dir, sizeof(scan_dir), dir, "scan_elements");
+	if (ret < 0)
+		return ret;
+
+	snprintf(name, sizeof(name), "in_voltage%u_en", index);
+	ret = write_file(scan_dir, name, "0\n");
+	if (ret < 0)
+		return ret;
+
+	snprintf(name, sizeof(name), "in_voltage%u_index", index);
+	ret = write_file(scan_dir, name, "%u\n", index);
+	if (ret < 0)
+		return ret;
+
+	snprintf(name, sizeof(name), "in_voltage%u_type", index);
+	return write_file(scan_dir, name, "le:s12/16>>4\n");
+}
+
+static int create_device(const char *root, unsigned int index,
+		unsigned int nb_channels, unsigned int nb_attrs)
+{
+	char dir[4096], sub[4096];
+	unsigned int i;
+	int ret;
+
+	ret = snprintf(dir, sizeof(dir), "%s/sys/bus/iio/devices/iio:device%u",
+			root, index);
+	if (ret < 0 || (size_t) ret >= sizeof(dir))
+		return -ENAMETOOLONG;
+
+	for (i = 0; i < sizeof(device_dirs) / sizeof(*device_dirs); i++) {
+		ret = join_path(sub, sizeof(sub), dir, device_dirs[i]);
+		if (ret < 0)
+			return ret;
+
+		ret = make_dirs(sub);
+		if (ret < 0)
+			return ret;
+	}
+
+	ret = write_file(dir, "name", "synth%u\n", index);
+	if (!ret)
+		ret = write_file(dir, "sampling_frequency", "1000000\n");
+	if (!ret)
+		ret = write_file(dir, "buffer/enable", "0\n");
+	if (!ret)
+		ret = write_file(dir, "buffer/length", "0\n");
+	if (!ret)
+		ret = write_file(dir, "trigger/current_trigger", "\n");
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < nb_channels; i++) {
+		ret = create_channel(dir, i, nb_attrs);
+		if (ret < 0)
+			return ret;
+	}
+
+	/* The timestamp comes after all the other channels */
+	ret = join_path(sub, sizeof(sub), dir, "scan_elements");
+	if (!ret)
+		ret = write_file(sub, "in_timestamp_en", "0\n");
+	if (!ret)
+		ret = write_file(sub, "in_timestamp_index", "%u\n",
+				nb_channels);
+	if (!ret)
+		ret = write_file(sub, "in_timestamp_type", "le:s64/64>>0\n");
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, nb_devices = DEFAULT_DEVICES,
+		     nb_channels = DEFAULT_CHANNELS,
+		     nb_attrs = DEFAULT_ATTRIBUTES;
+	int c, option_index = 0, ret = 0;
+
+	while ((c = getopt_long(argc, argv, "+hd:c:a:",
+					options, &option_index)) != -1) {
+		switch (c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case 'd':
+			nb_devices = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			nb_channels = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case 'a':
+			nb_attrs = (unsigned int) strtoul(optarg, NULL, 10);
+			break;
+		case '?':
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		fprintf(stderr, "Incorrect number of arguments.\n\n");
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; !ret && i < nb_devices; i++)
+		ret = create_device(argv[optind], i, nb_channels, nb_attrs);
+
+	if (ret < 0) {
+		fprintf(stderr, "Unable to create the tree: %s\n",
+				strerror(-ret));
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
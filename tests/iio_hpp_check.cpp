@@ -0,0 +1,119 @@
+/*
+ * libiio - Library for interfacing industrial I/O (IIO) devices
+ *
+ * Copyright (C) 2026 Analog Devices, Inc.
+ * Author: agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * */
+
+/* Builds every instantiation of iio.hpp, so that the header is compiled
+ * with the library. When run, it captures one buffer and prints the range
+ * of the samples of each channel, read with iio::visit_channel, and checks
+ * them against iio::make_channel_view where the format allows it. */
+
+#include <iio.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+#define MY_NAME "iio_hpp_check"
+
+#define DEFAULT_SAMPLES 1024
+
+namespace {
+
+struct range {
+	long long min, max, sum;
+
+	range() : min(std::numeric_limits<long long>::max()),
+		max(std::numeric_limits<long long>::min()), sum(0) {}
+
+	/* C++11 has no generic lambdas: visit_channel gets a functor */
+	template <typename View> void operator()(const View &view)
+	{
+		for (auto value : view) {
+			long long v = (long long) value;
+
+			if (v < min)
+				min = v;
+			if (v > max)
+				max = v;
+			sum += v;
+		}
+	}
+};
+
+int check(const char *uri, const char *name, std::size_t samples)
+{
+	iio::context ctx(uri);
+	iio::device dev = ctx.find_device(name);
+
+	for (unsigned int i = 0; i < dev.channels_count(); i++) {
+		iio::channel chn = dev.get_channel(i);
+
+		if (chn.is_scan_element() && !chn.is_output())
+			chn.enable();
+	}
+
+	iio::buffer buf(dev, samples);
+	buf.refill();
+
+	for (unsigned int i = 0; i < dev.channels_count(); i++) {
+		iio::channel chn = dev.get_channel(i);
+		range r;
+
+		if (!chn.is_enabled())
+			continue;
+
+		iio::visit_channel(buf, chn, r);
+		std::printf("%s: min %lld, max %lld\n", chn.id(), r.min, r.max);
+
+		const iio_data_format &fmt = chn.format();
+		if (fmt.length != 16 || !fmt.is_signed || fmt.is_be ||
+				fmt.bits != 16 || fmt.shift)
+			continue;
+
+		range typed;
+		typed(iio::make_channel_view<std::int16_t>(buf, chn));
+		if (typed.sum != r.sum) {
+			std::fprintf(stderr, "%s: make_channel_view and "
+					"visit_channel disagree\n", chn.id());
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	std::size_t samples = DEFAULT_SAMPLES;
+
+	if (argc < 3 || argc > 4) {
+		std::printf("Usage:\n\t" MY_NAME " <uri> <device> [samples]\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc == 4)
+		samples = (std::size_t) std::strtoul(argv[3], NULL, 10);
+
+	try {
+		return check(argv[1], argv[2], samples);
+	} catch (const iio::error &err) {
+		std::fprintf(stderr, MY_NAME ": %s\n", err.what());
+		return EXIT_FAILURE;
+	}
+}
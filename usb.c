@@ -951,6 +951,7 @@ struct iio_context * usb_create_context(unsigned int bus,
 	if (ret < 0)
 		goto err_context_destroy;
 
+	iio_context_init_scales(ctx);
 	return ctx;
 
 err_context_destroy: